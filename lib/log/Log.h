@@ -0,0 +1,336 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef LOG_H
+#define	LOG_H
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <pthread.h>
+
+// Messages waiting to be written. A full ring drops new messages rather than
+// blocking the caller.
+#define LOG_RING_CAPACITY 1024
+#define LOG_MESSAGE_LENGTH 240
+
+// Messages from a single call site beyond this many per second are
+// suppressed and counted
+#define LOG_RATE_LIMIT_PER_S 10
+
+// How long the writer thread sleeps when there is nothing to write
+#define LOG_DRAIN_PERIOD_MS 10
+
+namespace stlog {
+
+    enum class Level : int {
+        DEBUG = 0,
+        INFO,
+        WARNING,
+        ERROR
+    };
+    
+    /**
+     * Parse a level name: "debug", "info", "warning" or "error", in any case.
+     * @return False if value is not a known level, in which case level is not
+     * changed.
+     */
+    inline bool parseLevel(std::string value, Level& level) {
+        
+        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+        
+        if (value == "debug") {
+            level = Level::DEBUG;
+        } else if (value == "info") {
+            level = Level::INFO;
+        } else if (value == "warning") {
+            level = Level::WARNING;
+        } else if (value == "error") {
+            level = Level::ERROR;
+        } else {
+            return false;
+        }
+        
+        return true;
+    }
+
+    /**
+     * Per call site rate limiter. Allows LOG_RATE_LIMIT_PER_S messages in 
+     * each one second window and counts the rest.
+     */
+    class RateLimiter {
+    public:
+
+        RateLimiter(void) :
+          window_start_ns(0)
+        , count(0)
+        , suppressed(0) { }
+
+        /**
+         * @param suppressed_before Set to the number of messages suppressed 
+         * since the last one that was allowed.
+         * @return True if the message may be logged.
+         */
+        bool allow(int64_t now_ns, uint64_t& suppressed_before) {
+            
+            int64_t start = window_start_ns.load(std::memory_order_relaxed);
+            
+            // Whoever wins the exchange opens the next window
+            if (now_ns - start >= 1000000000LL &&
+                window_start_ns.compare_exchange_strong(start, now_ns, std::memory_order_relaxed)) {
+                count.store(0, std::memory_order_relaxed);
+            }
+            
+            if (count.fetch_add(1, std::memory_order_relaxed) >= LOG_RATE_LIMIT_PER_S) {
+                suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            
+            suppressed_before = suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+    private:
+        
+        std::atomic<int64_t> window_start_ns;
+        std::atomic<uint32_t> count;
+        std::atomic<uint64_t> suppressed;
+    };
+
+    /**
+     * Process wide asynchronous log. Any thread can write without locking or
+     * doing I/O: messages are copied into a bounded lock-free ring and written
+     * to the terminal by a background thread. Warnings and errors go to 
+     * std::cerr, everything else to std::cout. Messages still in the ring
+     * are written when the process exits normally, including through exit().
+     * A child created by fork() starts its own writer thread. Messages that 
+     * were queued at the time of the fork are written by both processes.
+     * 
+     * The minimum level is INFO in release builds and DEBUG otherwise. Set the
+     * STLOG_LEVEL environment variable to a level name to override it.
+     * 
+     * Use the STLOG_* macros, which add per call site rate limiting.
+     */
+    class Log {
+    public:
+        
+        static Log& instance(void) {
+            static Log log;
+            return log;
+        }
+        
+        /**
+         * Queue a message. Never blocks.
+         * @return False if the ring was full and the message was dropped.
+         */
+        bool write(Level level, const std::string& message, uint64_t suppressed_before = 0) {
+            
+            if (level < minimum_level.load(std::memory_order_relaxed)) {
+                return true;
+            }
+            
+            // Bounded MPMC queue after Dmitry Vyukov. Each cell's sequence 
+            // number says whether it is free for the producer at position pos
+            // (sequence == pos) or holds a message for the consumer at pos 
+            // (sequence == pos + 1).
+            uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+            Entry* entry;
+            
+            while (true) {
+                
+                entry = &ring[pos % LOG_RING_CAPACITY];
+                uint64_t sequence = entry->sequence.load(std::memory_order_acquire);
+                int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+                
+                if (difference == 0) {
+                    if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            
+            entry->level = level;
+            entry->suppressed_before = suppressed_before;
+            size_t length = std::min(message.size(), static_cast<size_t>(LOG_MESSAGE_LENGTH - 1));
+            std::memcpy(entry->message, message.data(), length);
+            entry->message[length] = '\0';
+            
+            entry->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+        
+        // Messages below this level are discarded by write
+        void set_level(Level value) { minimum_level = value; }
+        Level get_level(void) { return minimum_level; }
+        
+        // Write everything queued so far. Called by the writer thread and on 
+        // exit; may also be called before a deliberate abort.
+        void flush(void) {
+            
+            std::lock_guard<std::mutex> lk(drain_mutex);
+            drain();
+        }
+        
+    private:
+        
+        struct Entry {
+            std::atomic<uint64_t> sequence;
+            Level level;
+            uint64_t suppressed_before;
+            char message[LOG_MESSAGE_LENGTH];
+        };
+        
+        Entry ring[LOG_RING_CAPACITY];
+        std::atomic<uint64_t> enqueue_pos;
+        uint64_t dequeue_pos; // Guarded by drain_mutex
+        std::atomic<uint64_t> dropped;
+        std::atomic<Level> minimum_level;
+        
+        std::mutex drain_mutex;
+        std::atomic<bool> running;
+        std::thread writer;
+        
+        Log(void) :
+          enqueue_pos(0)
+        , dequeue_pos(0)
+        , dropped(0)
+#ifdef NDEBUG
+        , minimum_level(Level::INFO)
+#else
+        , minimum_level(Level::DEBUG)
+#endif
+        , running(true) {
+            
+            for (uint64_t i = 0; i < LOG_RING_CAPACITY; ++i) {
+                ring[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            
+            const char* level_name = std::getenv("STLOG_LEVEL");
+            if (level_name && *level_name) {
+                Level level;
+                if (parseLevel(level_name, level)) {
+                    minimum_level = level;
+                } else {
+                    std::cerr << "Unknown STLOG_LEVEL \"" << level_name << "\". Keeping the default.\n";
+                }
+            }
+            
+            writer = std::thread(&Log::writeInBackground, this);
+            
+            pthread_atfork(&Log::prepareFork, &Log::parentAfterFork, &Log::childAfterFork);
+        }
+        
+        ~Log(void) {
+            
+            running = false;
+            writer.join();
+            flush();
+        }
+        
+        Log(const Log&) = delete;
+        Log& operator=(const Log&) = delete;
+        
+        // The drain lock is held across fork() so that the child does not 
+        // inherit it locked by a writer thread it does not have
+        static void prepareFork(void) { instance().drain_mutex.lock(); }
+        static void parentAfterFork(void) { instance().drain_mutex.unlock(); }
+        
+        static void childAfterFork(void) {
+            
+            Log& log = instance();
+            log.drain_mutex.unlock();
+            
+            // Only the handle of the writer thread was inherited
+            if (log.running) {
+                log.writer.detach();
+                log.writer = std::thread(&Log::writeInBackground, &log);
+            }
+        }
+        
+        void writeInBackground(void) {
+            
+            while (running) {
+                flush();
+                std::this_thread::sleep_for(std::chrono::milliseconds(LOG_DRAIN_PERIOD_MS));
+            }
+        }
+        
+        // The caller must hold drain_mutex
+        void drain(void) {
+            
+            while (true) {
+                
+                Entry& entry = ring[dequeue_pos % LOG_RING_CAPACITY];
+                
+                if (entry.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+                    break;
+                }
+                
+                std::ostream& out = entry.level >= Level::WARNING ? std::cerr : std::cout;
+                
+                if (entry.suppressed_before > 0) {
+                    out << "(" << entry.suppressed_before << " similar messages suppressed)\n";
+                }
+                out << entry.message;
+                
+                // Hand the cell back to producers a full lap later
+                entry.sequence.store(dequeue_pos + LOG_RING_CAPACITY, std::memory_order_release);
+                dequeue_pos++;
+            }
+            
+            uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0) {
+                std::cerr << lost << " log messages were dropped because the log was full.\n";
+            }
+            
+            std::cout.flush();
+        }
+    };
+}
+
+// Log a std::string expression at a given level. The message is only built 
+// if the call site is within its rate limit.
+#define STLOG(level, message) \
+    do { \
+        if ((level) >= stlog::Log::instance().get_level()) { \
+            static stlog::RateLimiter stlog_limiter_; \
+            uint64_t stlog_suppressed_ = 0; \
+            if (stlog_limiter_.allow(std::chrono::duration_cast<std::chrono::nanoseconds>( \
+                    std::chrono::steady_clock::now().time_since_epoch()).count(), stlog_suppressed_)) { \
+                stlog::Log::instance().write((level), (message), stlog_suppressed_); \
+            } \
+        } \
+    } while (0)
+
+#define STLOG_DEBUG(message) STLOG(stlog::Level::DEBUG, message)
+#define STLOG_INFO(message) STLOG(stlog::Level::INFO, message)
+#define STLOG_WARNING(message) STLOG(stlog::Level::WARNING, message)
+#define STLOG_ERROR(message) STLOG(stlog::Level::ERROR, message)
+
+#endif	/* LOG_H */
@@ -0,0 +1,317 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef CLIENTTABLE_H
+#define	CLIENTTABLE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <signal.h>
+#include <unistd.h>
+
+#include "QoS.h"
+#include "Sample.h"
+
+#define SHMEM_MAX_CLIENTS 32
+
+// How often a waiting server looks for dead clients
+#define SHMEM_LIVENESS_CHECK_MS 10
+
+// A client that has not shown signs of life for this many stream periods is
+// evicted even if its process still exists, unless the server was given a 
+// lease explicitly
+#define SHMEM_LEASE_PERIODS 2
+
+// The lease before the stream period is known
+#define SHMEM_DEFAULT_CLIENT_LEASE_MS 1000
+
+// Idle clients renew their lease every SHMEM_LIVENESS_CHECK_MS
+#define SHMEM_MIN_CLIENT_LEASE_MS (4 * SHMEM_LIVENESS_CHECK_MS)
+
+namespace shmem {
+
+    /**
+     * A client's registration with a server. Clients renew it by updating
+     * their heartbeat whenever they read or wait to read.
+     */
+    struct ClientLease {
+        
+        bool in_use;
+        uint64_t ticket;      // Unique per registration, so an evicted client can tell
+        pid_t pid;
+        QoS qos;
+        std::atomic<int64_t> heartbeat_ns; // steady_clock, written without the lock
+        uint32_t last_read;                // Last publication read
+        uint32_t counted_read;             // Publication whose read was counted toward releasing the server
+        int pinned_slot;                   // Frame slot held by the client, if any
+        uint32_t pinned_generation;
+    };
+
+    /**
+     * The period of a stream, measured between publications, and the client
+     * lease that follows from it. Slow lossless clients hold publication 
+     * back, so the period and the lease stretch to fit them.
+     */
+    class StreamPeriod {
+    public:
+        
+        StreamPeriod(void) : 
+          last_ns(0)
+        , period_ns(0) { }
+        
+        // Call once per publication
+        void tick(int64_t now_ns) {
+            
+            if (last_ns > 0) {
+                int64_t period = now_ns - last_ns;
+                period_ns = period_ns == 0 ? period : (7 * period_ns + period) / 8;
+            }
+            
+            last_ns = now_ns;
+        }
+        
+        int64_t lease_ns(void) const {
+            
+            if (period_ns == 0) {
+                return SHMEM_DEFAULT_CLIENT_LEASE_MS * 1000000LL;
+            }
+            
+            return std::max<int64_t>(SHMEM_LEASE_PERIODS * period_ns, 
+                                     SHMEM_MIN_CLIENT_LEASE_MS * 1000000LL);
+        }
+        
+    private:
+        
+        int64_t last_ns;
+        int64_t period_ns;
+    };
+
+    /**
+     * Registry of the clients of one shared object, kept in shared memory 
+     * next to it. Lossless clients are counted so that the server can wait
+     * for all of them to read each publication. Dead clients are found by
+     * their expired lease and evicted so that they cannot stall the server.
+     * 
+     * All methods except heartbeat must be called with the owning object's 
+     * mutex held.
+     */
+    class ClientTable {
+    public:
+
+        ClientTable(void) :
+          number_of_clients(0)
+        , number_of_latest_only_clients(0)
+        , client_read_count(0)
+        , awaiting_reads(false)
+        , next_ticket(1)
+        , last_check_ns(0) {
+            
+            for (int i = 0; i < SHMEM_MAX_CLIENTS; ++i) {
+                leases[i].in_use = false;
+            }
+        }
+        
+        size_t number_of_clients; // Lossless clients, which the server waits for
+        size_t number_of_latest_only_clients;
+        
+        // Lossless reads of the latest publication. The server is waiting on
+        // its clients while awaiting_reads is set.
+        size_t client_read_count;
+        bool awaiting_reads;
+
+        /**
+         * Register the calling process as a client.
+         * @param publication The latest publication, which a new client 
+         * reads first
+         * @return Index of the new lease, or -1 if the table is full.
+         */
+        int add(QoS qos, uint32_t publication, uint64_t& ticket) {
+            
+            for (int i = 0; i < SHMEM_MAX_CLIENTS; ++i) {
+                
+                if (!leases[i].in_use) {
+                    
+                    ClientLease& lease = leases[i];
+                    lease.in_use = true;
+                    lease.ticket = ticket = next_ticket++;
+                    lease.pid = getpid();
+                    lease.qos = qos;
+                    lease.heartbeat_ns = Sample::nowInNs();
+                    lease.last_read = publication;
+                    lease.counted_read = 0;
+                    lease.pinned_slot = -1;
+                    lease.pinned_generation = 0;
+                    
+                    if (qos == QoS::LOSSLESS) {
+                        number_of_clients++;
+                    } else {
+                        number_of_latest_only_clients++;
+                    }
+                    
+                    return i;
+                }
+            }
+            
+            return -1;
+        }
+        
+        /**
+         * Check whether a lease still belongs to the client holding ticket,
+         * i.e. that the client has not been evicted.
+         */
+        bool owns(int index, uint64_t ticket) {
+            return index >= 0 && leases[index].in_use && leases[index].ticket == ticket;
+        }
+        
+        ClientLease& lease(int index) {
+            return leases[index];
+        }
+        
+        /**
+         * Renew a lease. Does not need the lock.
+         */
+        void heartbeat(int index) {
+            leases[index].heartbeat_ns.store(Sample::nowInNs(), std::memory_order_relaxed);
+        }
+        
+        /**
+         * Server: a new value has been published. 
+         * @return True if the server must wait for lossless clients to read it.
+         */
+        bool startPublication(void) {
+            
+            client_read_count = 0;
+            awaiting_reads = number_of_clients > 0;
+            return awaiting_reads;
+        }
+        
+        /**
+         * Client: record a read of publication and count it toward 
+         * releasing the server. 
+         * @return True if this was the last read the server was waiting for,
+         * in which case the caller must release the server.
+         */
+        bool countRead(int index, uint32_t publication) {
+            
+            ClientLease& lease = leases[index];
+            lease.last_read = publication;
+            
+            if (lease.qos != QoS::LOSSLESS || !awaiting_reads) {
+                return false;
+            }
+            
+            client_read_count++;
+            lease.counted_read = publication;
+            
+            return readsComplete();
+        }
+        
+        /**
+         * Remove a client. publication is the latest publication, which the
+         * server may be waiting for this client to read.
+         * @return True if the server was waiting only on this client, in which
+         * case the caller must release the server.
+         */
+        bool remove(int index, uint32_t publication) {
+            
+            ClientLease& lease = leases[index];
+            lease.in_use = false;
+            
+            if (lease.qos != QoS::LOSSLESS) {
+                number_of_latest_only_clients--;
+                return false;
+            }
+            
+            number_of_clients--;
+            
+            if (!awaiting_reads) {
+                return false;
+            }
+            
+            // If it had already read, its read no longer counts
+            if (lease.counted_read == publication) {
+                client_read_count--;
+            }
+            
+            return readsComplete();
+        }
+        
+        /**
+         * Server: evict clients whose process has exited or whose lease has 
+         * expired. Checks run at most every SHMEM_LIVENESS_CHECK_MS. 
+         * on_evict(lease) is called for each evicted client so the owner can
+         * free resources it held, such as pinned frame slots.
+         * @return True if the server was waiting only on evicted clients and
+         * may proceed.
+         */
+        template <class OnEvict>
+        bool evictDeadClients(int64_t lease_ns, uint32_t publication, OnEvict on_evict) {
+            
+            int64_t now = Sample::nowInNs();
+            
+            if (now - last_check_ns < SHMEM_LIVENESS_CHECK_MS * 1000000LL) {
+                return false;
+            }
+            
+            last_check_ns = now;
+            bool release = false;
+            
+            for (int i = 0; i < SHMEM_MAX_CLIENTS; ++i) {
+                
+                ClientLease& lease = leases[i];
+                
+                if (!lease.in_use) {
+                    continue;
+                }
+                
+                int64_t silent_ns = now - lease.heartbeat_ns.load(std::memory_order_relaxed);
+                
+                // Only probe the process once it has been quiet for a while,
+                // so healthy clients cost nothing
+                bool dead = silent_ns > lease_ns ||
+                        (silent_ns > 2 * SHMEM_LIVENESS_CHECK_MS * 1000000LL && 
+                         kill(lease.pid, 0) == -1 && errno == ESRCH);
+                
+                if (dead) {
+                    on_evict(lease);
+                    release = remove(i, publication) || release;
+                }
+            }
+            
+            return release;
+        }
+
+    private:
+        
+        bool readsComplete(void) {
+            
+            if (awaiting_reads && client_read_count >= number_of_clients) {
+                awaiting_reads = false;
+                return true;
+            }
+            
+            return false;
+        }
+
+        ClientLease leases[SHMEM_MAX_CLIENTS];
+        uint64_t next_ticket;
+        int64_t last_check_ns;
+    };
+}
+
+#endif	/* CLIENTTABLE_H */
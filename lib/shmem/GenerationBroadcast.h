@@ -0,0 +1,144 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef GENERATIONBROADCAST_H
+#define	GENERATIONBROADCAST_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#ifdef __linux__
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace shmem {
+
+    /**
+     * A generation counter that lives in shared memory. The server advances
+     * it once per publication and every waiting client is woken by a single 
+     * system call. Clients remember the last generation they read and wait
+     * for it to change, so no per-client bookkeeping or semaphore posts are 
+     * needed to tell them that new data is available.
+     * 
+     * On Linux waiting uses a process-shared futex on the counter. Elsewhere 
+     * it falls back to polling.
+     */
+    class GenerationBroadcast {
+    public:
+
+        GenerationBroadcast(void) :
+          generation(0)
+        , waiters(0) { }
+
+        uint32_t get(void) const {
+            return generation.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Advance the generation. Anything written to shared memory before 
+         * this call is visible to clients that see the new generation. Call
+         * this in the same critical section as the write, so that a client 
+         * that reads the new data also reads the new generation, and follow
+         * it with wake once the lock is released.
+         */
+        void advance(void) {
+            generation.fetch_add(1, std::memory_order_seq_cst);
+        }
+        
+        // Wake everyone waiting for the generation to change
+        void wake(void) {
+
+            // Skip the system call if nobody is asleep. Waiters register 
+            // before checking the generation, so either they see the new 
+            // value or we see them.
+            if (waiters.load(std::memory_order_seq_cst) > 0) {
+                wakeAll();
+            }
+        }
+
+        /**
+         * Block until the generation differs from seen.
+         * @return False on timeout.
+         */
+        bool waitForChange(uint32_t seen, std::chrono::microseconds timeout) {
+
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+
+            while (get() == seen) {
+
+                auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+                        deadline - std::chrono::steady_clock::now());
+
+                if (remaining.count() <= 0) {
+                    return false;
+                }
+
+                waiters.fetch_add(1, std::memory_order_seq_cst);
+                if (get() == seen) {
+                    sleepWhileUnchanged(seen, remaining);
+                }
+                waiters.fetch_sub(1, std::memory_order_seq_cst);
+            }
+
+            return true;
+        }
+
+    private:
+
+        // Must be lock-free and the same size as a plain 32 bit integer,
+        // since the kernel operates on it directly
+        std::atomic<uint32_t> generation;
+        std::atomic<uint32_t> waiters;
+
+#ifdef __linux__
+
+        int* futexAddress(void) {
+            return reinterpret_cast<int*>(&generation);
+        }
+
+        void wakeAll(void) {
+            syscall(SYS_futex, futexAddress(), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+
+        void sleepWhileUnchanged(uint32_t seen, std::chrono::microseconds timeout) {
+
+            struct timespec ts;
+            ts.tv_sec = timeout.count() / 1000000;
+            ts.tv_nsec = (timeout.count() % 1000000) * 1000;
+
+            // Returns immediately if the generation has already moved on, so 
+            // a publication between the check above and this call is not lost.
+            // Spurious returns are handled by the caller's loop.
+            syscall(SYS_futex, futexAddress(), FUTEX_WAIT, (int) seen, &ts, nullptr, 0);
+        }
+#else
+
+        void wakeAll(void) { }
+
+        void sleepWhileUnchanged(uint32_t seen, std::chrono::microseconds timeout) {
+            std::this_thread::sleep_for(std::min(timeout, std::chrono::microseconds(100)));
+        }
+#endif
+    };
+}
+
+#endif	/* GENERATIONBROADCAST_H */
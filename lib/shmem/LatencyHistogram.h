@@ -0,0 +1,148 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef LATENCYHISTOGRAM_H
+#define	LATENCYHISTOGRAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Each power of two is split into 2^SUB_BUCKET_BITS buckets, so recorded
+// values are accurate to about 3%
+#define LATENCYHISTOGRAM_SUB_BUCKET_BITS 5
+
+// Values of 2^MAX_EXPONENT ns (about 18 minutes) and longer share the last bucket
+#define LATENCYHISTOGRAM_MAX_EXPONENT 40
+
+namespace shmem {
+
+    /**
+     * Histogram of latencies in nanoseconds with log-linear buckets, in the
+     * style of HdrHistogram: relative precision is constant from 
+     * nanoseconds to minutes, recording is a few integer operations and 
+     * memory use is fixed.
+     */
+    class LatencyHistogram {
+    public:
+
+        LatencyHistogram(void) :
+          counts(bucketIndex(std::numeric_limits<int64_t>::max()) + 1, 0) { 
+            
+            reset();
+        }
+
+        void record(int64_t value_ns) {
+            
+            if (value_ns < 0) {
+                value_ns = 0;
+            }
+            
+            counts[bucketIndex(value_ns)]++;
+            total_count++;
+            sum_ns += value_ns;
+            min_ns = std::min(min_ns, value_ns);
+            max_ns = std::max(max_ns, value_ns);
+        }
+        
+        void reset(void) {
+            
+            std::fill(counts.begin(), counts.end(), 0);
+            total_count = 0;
+            sum_ns = 0;
+            min_ns = std::numeric_limits<int64_t>::max();
+            max_ns = 0;
+        }
+
+        /**
+         * @param percentile In [0, 100]
+         * @return Upper bound of the bucket holding the given percentile, so
+         * that reported latencies are never optimistic. Zero if empty.
+         */
+        int64_t valueAtPercentile(double percentile) const {
+            
+            if (total_count == 0) {
+                return 0;
+            }
+            
+            uint64_t target = static_cast<uint64_t>(percentile / 100.0 * total_count + 0.5);
+            target = std::max<uint64_t>(1, std::min(target, total_count));
+            
+            uint64_t seen = 0;
+            for (size_t i = 0; i < counts.size(); ++i) {
+                
+                seen += counts[i];
+                if (seen >= target) {
+                    return std::min(bucketUpperBound(i), max_ns);
+                }
+            }
+            
+            return max_ns;
+        }
+        
+        uint64_t get_count(void) const { return total_count; }
+        int64_t get_min(void) const { return total_count > 0 ? min_ns : 0; }
+        int64_t get_max(void) const { return max_ns; }
+        double get_mean(void) const { return total_count > 0 ? static_cast<double>(sum_ns) / total_count : 0.0; }
+
+    private:
+        
+        static const int64_t sub_buckets = 1 << LATENCYHISTOGRAM_SUB_BUCKET_BITS;
+        
+        std::vector<uint64_t> counts;
+        uint64_t total_count;
+        int64_t sum_ns;
+        int64_t min_ns;
+        int64_t max_ns;
+        
+        // Values below sub_buckets have a bucket each. Above that, a value 
+        // with its highest bit at position e lands in bucket group 
+        // e - SUB_BUCKET_BITS + 1, indexed by its next SUB_BUCKET_BITS bits.
+        static size_t bucketIndex(int64_t value) {
+            
+            if (value < sub_buckets) {
+                return static_cast<size_t>(value);
+            }
+            
+            int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+            
+            if (exponent >= LATENCYHISTOGRAM_MAX_EXPONENT) {
+                exponent = LATENCYHISTOGRAM_MAX_EXPONENT;
+                value = (int64_t(2) << exponent) - 1;
+            }
+            
+            int shift = exponent - LATENCYHISTOGRAM_SUB_BUCKET_BITS;
+            int64_t mantissa = value >> shift; // In [sub_buckets, 2 * sub_buckets)
+            
+            return static_cast<size_t>((shift + 1) * sub_buckets + (mantissa - sub_buckets));
+        }
+        
+        static int64_t bucketUpperBound(size_t index) {
+            
+            if (index < static_cast<size_t>(sub_buckets)) {
+                return static_cast<int64_t>(index);
+            }
+            
+            int shift = static_cast<int>(index / sub_buckets) - 1;
+            int64_t mantissa = sub_buckets + static_cast<int64_t>(index % sub_buckets);
+            
+            return ((mantissa + 1) << shift) - 1;
+        }
+    };
+}
+
+#endif	/* LATENCYHISTOGRAM_H */
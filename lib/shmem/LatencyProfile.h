@@ -0,0 +1,185 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef LATENCYPROFILE_H
+#define	LATENCYPROFILE_H
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "LatencyHistogram.h"
+#include "Sample.h"
+#include "StreamStats.h"
+
+namespace shmem {
+
+    /**
+     * Latency histograms kept by the last stage of a processing chain, built 
+     * from the stage stamps carried by each sample. For every stage there is
+     * a histogram of the time spent waiting for its input to arrive from the
+     * previous stage and one of the time spent processing it, followed by 
+     * the end-to-end latency from capture.
+     * 
+     * Recording and printing may happen on different threads. Histograms 
+     * are indexed by stage and allocated the first time a stage is seen, so
+     * recording does not allocate after that.
+     */
+    class LatencyProfile {
+    public:
+        
+        LatencyProfile(void) : 
+          number_seen(0) { }
+
+        /**
+         * @param sample A sample whose processing has just finished
+         * @param now_ns When processing finished, usually Sample::nowInNs()
+         */
+        void record(const Sample& sample, int64_t now_ns) {
+            
+            // Samples that were never stamped by a source have no capture time
+            if (sample.number == 0) {
+                return;
+            }
+            
+            std::lock_guard<std::mutex> lk(mutex);
+            
+            int64_t previous_exit_ns = sample.capture_time_ns;
+            
+            for (uint32_t i = 0; i < sample.number_of_stages; ++i) {
+                
+                const StageStamp& stamp = sample.stages[i];
+                Stage& stage = find(stamp.stage);
+                
+                // The source's input is the capture itself
+                if (i > 0) {
+                    stage.input.record(stamp.enter_ns - previous_exit_ns);
+                }
+                
+                stage.processing.record(stamp.processing_ns);
+                previous_exit_ns = stamp.exit_ns();
+            }
+            
+            end_to_end.record(now_ns - sample.capture_time_ns);
+        }
+        
+        void reset(void) {
+            
+            std::lock_guard<std::mutex> lk(mutex);
+            
+            for (int i = 0; i < number_seen; ++i) {
+                
+                Stage& stage = *stages[seen[i]];
+                stage.input.reset();
+                stage.processing.reset();
+                stage.listed = false;
+            }
+            
+            number_seen = 0;
+            end_to_end.reset();
+        }
+        
+        /**
+         * Print percentiles of each histogram in milliseconds.
+         */
+        void print(std::ostream& out, const std::string& title) {
+            
+            std::lock_guard<std::mutex> lk(mutex);
+            
+            std::ios::fmtflags flags = out.flags();
+            std::streamsize precision = out.precision();
+            
+            out << "Latency of \'" + title + "\' over " + std::to_string(end_to_end.get_count()) + " samples, in ms:\n";
+            out << std::left << std::setw(24) << "" << std::right;
+            out << std::setw(9) << "p50" << std::setw(9) << "p90" << std::setw(9) << "p99"
+                << std::setw(9) << "p99.9" << std::setw(9) << "max" << "\n";
+            
+            for (int i = 0; i < number_seen; ++i) {
+                
+                const Stage& stage = *stages[seen[i]];
+                std::string name = seen[i] < SHMEM_MAX_STAGES ? names.stageName(seen[i]) : "?";
+                
+                if (stage.input.get_count() > 0) {
+                    printRow(out, "  -> " + name, stage.input);
+                }
+                
+                printRow(out, name, stage.processing);
+            }
+            
+            printRow(out, "end to end", end_to_end);
+            
+            out.flags(flags);
+            out.precision(precision);
+        }
+
+    private:
+        
+        struct Stage {
+            LatencyHistogram input;      // Waiting for input from the previous stage
+            LatencyHistogram processing;
+            bool listed;                 // In seen
+            
+            Stage(void) : listed(false) { }
+        };
+        
+        std::mutex mutex;
+        
+        // By stage index. The last entry collects SHMEM_UNKNOWN_STAGE.
+        std::unique_ptr<Stage> stages[SHMEM_MAX_STAGES + 1];
+        
+        // Stage indices in the order they were first seen, which is the order
+        // of the processing chain
+        uint32_t seen[SHMEM_MAX_STAGES + 1];
+        int number_seen;
+        
+        LatencyHistogram end_to_end;
+        
+        // Resolves stage names when printing
+        StatsSegment names;
+        
+        Stage& find(uint32_t stage) {
+            
+            uint32_t index = stage < SHMEM_MAX_STAGES ? stage : SHMEM_MAX_STAGES;
+            
+            if (!stages[index]) {
+                stages[index].reset(new Stage);
+            }
+            
+            Stage& found = *stages[index];
+            
+            if (!found.listed) {
+                found.listed = true;
+                seen[number_seen++] = index;
+            }
+            
+            return found;
+        }
+        
+        static void printRow(std::ostream& out, const std::string& label, const LatencyHistogram& histogram) {
+            
+            out << std::left << std::setw(24) << label << std::right << std::fixed << std::setprecision(3);
+            out << std::setw(9) << histogram.valueAtPercentile(50.0) / 1e6
+                << std::setw(9) << histogram.valueAtPercentile(90.0) / 1e6
+                << std::setw(9) << histogram.valueAtPercentile(99.0) / 1e6
+                << std::setw(9) << histogram.valueAtPercentile(99.9) / 1e6
+                << std::setw(9) << histogram.get_max() / 1e6 << "\n";
+        }
+    };
+}
+
+#endif	/* LATENCYPROFILE_H */
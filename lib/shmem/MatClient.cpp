@@ -19,16 +19,25 @@
 #include <unistd.h>
 #include <boost/thread/thread_time.hpp>
 #include <boost/thread.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+
+#include "../log/Log.h"
 
 using namespace boost::interprocess;
 
 MatClient::MatClient(const std::string source_name) :
 name(source_name)
+, shared_object_found(false)
+, qos(shmem::QoS::LOSSLESS)
+, last_published(0)
+, client_index(-1)
+, client_ticket(0)
+, pinned_slot(-1)
+, pinned_generation(0)
+, dropped_samples(0)
 , shmem_name(source_name + "_sh_mem")
 , shobj_name(source_name + "_sh_obj")
-, shared_object_found(false)
-, mat_attached_to_header(false)
-, read_barrier_passed(false) {
+, mapped_generation(0) {
 }
 
 MatClient::~MatClient() {
@@ -36,7 +45,13 @@ MatClient::~MatClient() {
     detachFromShmem();
 }
 
-int MatClient::findSharedMat() {
+/**
+ * Find the shared cv::Mat and register as one of its clients.
+ * @param qos LOSSLESS clients read every frame and the server waits for them.
+ * LATEST_ONLY clients always get the newest frame and are never waited on.
+ * @return The number of clients, including this one.
+ */
+int MatClient::findSharedMat(shmem::QoS qos_in) {
 
 
     int client_num;
@@ -47,14 +62,10 @@ int MatClient::findSharedMat() {
 
     try {
 
-        // If the client creates the shared memory, it does not allocate room for the cv::Mat data
-        // The server will need to resize the shared memory to make room.
-        //size_t total_bytes = sizeof (shmem::SharedCVMatHeader) + 1024; 
-
-        // TODO: This is a complete HACK until I can figure out how to resize 
-        // the managed shared memory segment on the server side without 
-        // causing seg faults due to bad pointers on the client side.
-        size_t total_bytes = 1024e4;
+        // Only the header lives here, so the client can create it if the 
+        // server has not started yet. Frame data is in a separate segment
+        // that the server sizes to fit its frames.
+        size_t total_bytes = sizeof (shmem::SharedCVMatHeader) + 1024;
 
         shared_memory = managed_shared_memory(open_or_create, shmem_name.c_str(), total_bytes);
         shared_mat_header = shared_memory.find_or_construct<shmem::SharedCVMatHeader>(shobj_name.c_str())();
@@ -67,9 +78,11 @@ int MatClient::findSharedMat() {
 
     // Make sure everyone using this shared memory knows that another client
     // has joined
+    qos = qos_in;
     shared_mat_header->mutex.wait();
-    shared_mat_header->number_of_clients++;
-    client_num = shared_mat_header->number_of_clients;
+    joinClientTable();
+    client_num = shared_mat_header->clients.number_of_clients + 
+                 shared_mat_header->clients.number_of_latest_only_clients;
     shared_mat_header->mutex.post();
 
     return client_num;
@@ -80,74 +93,203 @@ int MatClient::findSharedMat() {
 // whatever processing they had in mind
 
 /**
- * Get the cv::Mat object from shared memory
- * @param value The cv::Mat object to be copied from shared memory
- * @return True if the result is (1) valid and (2) successfully obeyed all 
- * interprocess synchronization mechanisms. False if there were timeouts during
- * wait() calls, meaning that the cv::Mat objects has possibly not been assigned
- * or that proceeding to process in a loop that will recall this function may result
- * in server/client desynchronization.
+ * Get the cv::Mat object from shared memory. No pixel data is copied: value 
+ * is a view of a frame slot in shared memory that remains valid until the next
+ * call to getSharedMat or releaseSharedMat. It must be treated as read-only;
+ * callers that want to modify the frame must copy it first.
+ * @param value Set to reference the shared cv::Mat
+ * @return True if a frame newer than the last one read by this client was 
+ * obtained. False if no new frame was published within the timeout, in which
+ * case value is not assigned and the call can simply be repeated.
  */
 bool MatClient::getSharedMat(cv::Mat& value) {
 
-    boost::system_time timeout =
-            boost::get_system_time() + boost::posix_time::milliseconds(100);
-
-    if (!read_barrier_passed) {
+    if (!waitForFrame()) {
+        return false;
+    }
 
-        if (!shared_mat_header->read_barrier.timed_wait(timeout)) {
-            return false;
-        }
+    /* START CRITICAL SECTION */
+    shared_mat_header->mutex.wait();
+    
+    // The server evicted this client because its lease ran out, e.g. after
+    // it was stopped in a debugger. Its pin went with it.
+    if (!shared_mat_header->clients.owns(client_index, client_ticket)) {
+        
+        STLOG_WARNING("Client of \'" + name + "\' was evicted by the server and has rejoined.\n");
+        pinned_slot = -1;
+        joinClientTable();
+    }
 
-        // Write down that we made it past the read_barrier in case the
-        // new_data_barrier times out.
-        read_barrier_passed = true;
+    // Let go of the previous frame and hold on to the new one
+    shared_mat_header->releaseSlot(pinned_slot, pinned_generation);
+    pinned_slot = shared_mat_header->pinLatestSlot();
+    pinned_generation = shared_mat_header->get_generation();
+    mapDataSegment();
+    updateSample();
+    
+    // Recorded in the lease so that the server can free the slot if this 
+    // client dies while holding it
+    shmem::ClientLease& lease = shared_mat_header->clients.lease(client_index);
+    lease.pinned_slot = pinned_slot;
+    lease.pinned_generation = pinned_generation;
+    
+    last_published = shared_mat_header->published.get();
+
+    // Lossless clients let the server know they are done with this frame. The
+    // last one to read releases the server.
+    if (shared_mat_header->clients.countRead(client_index, last_published)) {
+        shared_mat_header->write_barrier.post();
+    }
 
-        /* START CRITICAL SECTION */
-        shared_mat_header->mutex.wait();
+    shared_mat_header->mutex.post();
+    /* END CRITICAL SECTION */
 
-        if (!mat_attached_to_header) {
-            // Cannot do this until the server has called build header. 
-            shared_mat_header->attachMatToHeader(shared_memory, mat);
-            mat_attached_to_header = true;
-        }
+    if (pinned_slot < 0 || mapped_generation != pinned_generation) {
+        return false;
+    }
 
-        value = mat.clone();
+    attachMatToPinnedSlot(value);
+    return true; // Result is valid and all waits have operated without timeout
+}
 
-        // Now that this client has finished its read, update the count
-        shared_mat_header->client_read_count++;
+/**
+ * Take a lease in the header's client table. Must be called with the header
+ * mutex held.
+ */
+void MatClient::joinClientTable() {
+    
+    client_index = shared_mat_header->clients.add(qos, shared_mat_header->published.get(), client_ticket);
+    
+    if (client_index < 0) {
+        shared_mat_header->mutex.post();
+        std::cerr << "\'" + name + "\' already has the maximum of " + std::to_string(SHMEM_MAX_CLIENTS) + " clients.\n";
+        exit(EXIT_FAILURE);
+    }
+}
 
-        // If all clients have read, signal the barrier
-        if (shared_mat_header->client_read_count == shared_mat_header->number_of_clients) {
-            shared_mat_header->write_barrier.post();
-            shared_mat_header->client_read_count = 0;
+/**
+ * Wait up to 100 ms for a frame this client has not read yet. All clients are
+ * woken together by a single broadcast from the server. The lease is renewed
+ * while waiting so that an idle stream does not get this client evicted.
+ * @return True if a new frame was published.
+ */
+bool MatClient::waitForFrame() {
+    
+    for (int i = 0; i < 100 / SHMEM_LIVENESS_CHECK_MS; ++i) {
+        
+        shared_mat_header->clients.heartbeat(client_index);
+        
+        if (shared_mat_header->published.waitForChange(last_published, 
+                std::chrono::milliseconds(SHMEM_LIVENESS_CHECK_MS))) {
+            return true;
         }
-
-        shared_mat_header->mutex.post();
-        /* END CRITICAL SECTION */
     }
+    
+    return false;
+}
 
-    if (!shared_mat_header->new_data_barrier.timed_wait(timeout)) {
+/**
+ * Map the frame data segment of the current generation if it is not mapped 
+ * already. Must be called with the header mutex held so that the server cannot
+ * move to another generation and remove the segment while it is being opened.
+ * @return False if there is no data segment to map.
+ */
+bool MatClient::mapDataSegment() {
+    
+    uint32_t generation = shared_mat_header->get_generation();
+    
+    if (generation == 0) {
+        return false;
+    }
+    
+    if (generation == mapped_generation) {
+        return true;
+    }
+    
+    try {
+        
+        shared_memory_object data_segment(open_only,
+                shmem::SharedCVMatHeader::dataSegmentName(name, generation).c_str(),
+                read_only);
+        data_region = mapped_region(data_segment, read_only);
+        
+    } catch (interprocess_exception& ex) {
+        std::cerr << ex.what() << '\n';
         return false;
     }
+    
+    mapped_generation = generation;
+    
+    // Copy out the geometry while the header is locked, since the server 
+    // may change it as soon as the lock is released
+    mat_size = shared_mat_header->get_mat_size();
+    mat_type = shared_mat_header->get_type();
+    slot_bytes = shared_mat_header->get_slot_bytes();
+    
+    return true;
+}
 
-    read_barrier_passed = false;
-    return true; // Result is valid and all waits have operated without timeout
+/**
+ * Copy the identity of the newly pinned frame and count any samples that were
+ * skipped since the last one. Must be called with the header mutex held.
+ */
+void MatClient::updateSample() {
+    
+    if (pinned_slot < 0) {
+        return;
+    }
+    
+    shmem::Sample next = shared_mat_header->get_slot_sample(pinned_slot);
+    
+    if (sample.number > 0 && next.number > sample.number + 1) {
+        dropped_samples += next.number - sample.number - 1;
+    }
+    
+    sample = next;
+}
+
+void MatClient::attachMatToPinnedSlot(cv::Mat& value) {
+    
+    // The mapping is read-only, so writing to value would fault. Callers have 
+    // to copy the frame before changing it.
+    char* data = static_cast<char*>(data_region.get_address());
+    value = cv::Mat(mat_size, mat_type, data + pinned_slot * slot_bytes);
+}
+
+void MatClient::releaseSharedMat() {
+    
+    if (shared_object_found && pinned_slot >= 0) {
+        
+        shared_mat_header->mutex.wait();
+        if (shared_mat_header->clients.owns(client_index, client_ticket)) {
+            shared_mat_header->releaseSlot(pinned_slot, pinned_generation);
+            shared_mat_header->clients.lease(client_index).pinned_slot = -1;
+        }
+        shared_mat_header->mutex.post();
+        
+        pinned_slot = -1;
+    }
 }
 
 void MatClient::detachFromShmem() {
 
     if (shared_object_found) {
 
-        // Make sure nobody is going to wait on a disposed object
+        // Make sure nobody is going to wait on a disposed object. If the 
+        // server is waiting on the latest frame, this client no longer needs
+        // to read it. A client that was evicted has nothing left to give back.
         shared_mat_header->mutex.wait();
-        shared_mat_header->number_of_clients--;
+        if (shared_mat_header->clients.owns(client_index, client_ticket)) {
+            
+            shared_mat_header->releaseSlot(pinned_slot, pinned_generation);
+            
+            if (shared_mat_header->clients.remove(client_index, shared_mat_header->published.get())) {
+                shared_mat_header->write_barrier.post();
+            }
+        }
         shared_mat_header->mutex.post();
 
-#ifndef NDEBUG
-        std::cout << "Number of clients in \'" + shmem_name + "\' was decremented.\n";
-#endif
+        STLOG_DEBUG("Number of clients in \'" + shmem_name + "\' was decremented.\n");
 
     }
 }
-
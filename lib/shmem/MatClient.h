@@ -19,10 +19,13 @@
 
 #include <string>
 #include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <boost/interprocess/sync/sharable_lock.hpp>
 #include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <opencv2/core/mat.hpp>
 
+#include "QoS.h"
+#include "Sample.h"
 #include "SharedCVMatHeader.h"
 
 class MatClient {
@@ -32,10 +35,13 @@ public:
     virtual ~MatClient();
     
     // Find cv::Mat object in shared memory
-    int findSharedMat(void);
+    int findSharedMat(shmem::QoS qos = shmem::QoS::LOSSLESS);
     
-    // get cv::Mat out of shared memory
+    // Get a read-only view of the latest cv::Mat in shared memory
     bool getSharedMat(cv::Mat& value);
+    
+    // Let the server reuse the frame returned by the last getSharedMat call
+    void releaseSharedMat(void);
      
     // Accessors
     std::string get_name(void) { return name; }
@@ -44,20 +50,57 @@ public:
     float get_worldunits_per_px_x(void) { return shared_mat_header->worldunits_per_px_x; }
     float get_worldunits_per_px_y(void) { return shared_mat_header->worldunits_per_px_y; }
     
+    // Identity of the frame returned by the last successful getSharedMat call
+    shmem::Sample get_sample(void) { return sample; }
+    
+    // Number of samples that were never seen by this client. Lossless clients 
+    // only miss samples that the server dropped before publication.
+    uint64_t get_dropped_samples(void) { return dropped_samples; }
+    
+    // Frames the server dropped before publication. Compare with 
+    // get_dropped_samples to tell whether missing samples were lost at the 
+    // server, because its producer outpaced publication, or by this client.
+    uint64_t get_server_dropped_samples(void) { return shared_mat_header->dropped_samples; }
+    
 private:
     
     std::string name;
     shmem::SharedCVMatHeader* shared_mat_header;
-    bool shared_object_found, mat_attached_to_header;
-    bool read_barrier_passed;
-    int data_size; // Size of raw mat data in bytes
-
-    // Shared mat object, constructed from the shared_mat_header
-    cv::Mat mat;
+    bool shared_object_found;
+    
+    // Lossless or latest-only
+    shmem::QoS qos;
+    
+    // Publication generation of the last frame read
+    uint32_t last_published;
+    
+    // This client's lease in the header's client table
+    int client_index;
+    uint64_t client_ticket;
+    
+    // The shared memory slot this client is currently holding a view of
+    int pinned_slot;
+    uint32_t pinned_generation;
+    
+    // Identity of the pinned frame and gap accounting
+    shmem::Sample sample;
+    uint64_t dropped_samples;
 
     const std::string shmem_name, shobj_name;
     boost::interprocess::managed_shared_memory shared_memory;
     
+    // Frame data segment and the geometry of its frames
+    boost::interprocess::mapped_region data_region;
+    uint32_t mapped_generation;
+    cv::Size mat_size;
+    int mat_type;
+    size_t slot_bytes;
+    
+    void joinClientTable(void);
+    bool waitForFrame(void);
+    bool mapDataSegment(void);
+    void attachMatToPinnedSlot(cv::Mat& value);
+    void updateSample(void);
     void detachFromShmem(void);
 };
 
@@ -16,22 +16,45 @@
 
 #include "MatServer.h"
 
+#include <algorithm>
 #include <chrono>
 #include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/thread/thread_time.hpp>
 
 #include "SharedCVMatHeader.h"
+#include "../log/Log.h"
 #include "SharedCVMatHeader.cpp" // TODO: Why???
 
 
 
 using namespace boost::interprocess;
 
-MatServer::MatServer(const std::string sink_name) :
+/**
+ * @param sink_name Name of the frame SINK
+ * @param slots Number of frames preallocated in shared memory. Together with 
+ * the frame size this sets the memory used by the server, which does not grow 
+ * while serving. At least two slots are needed so that the server can write
+ * one frame while clients read another.
+ * @param policy What to do with a new frame when every slot is queued for 
+ * publication or held by a client
+ */
+MatServer::MatServer(const std::string sink_name, int slots, shmem::OverflowPolicy policy) :
 name(sink_name)
-, shmem_name(sink_name + "_sh_mem")
-, shobj_name(sink_name + "_sh_obj")
+, overflow_policy(policy)
+, dropped_samples(0)
+, client_lease_ns(0)
+, number_evicted(0)
+, last_client_stats_ns(0)
+, running(true)
 , shared_object_created(false)
-, running(true) {
+, mat_acquired(false)
+, shmem_name(sink_name + "_sh_mem")
+, shobj_name(sink_name + "_sh_obj") {
+
+    stats = stats_segment.claim(name, "MatServer");
+    stage = stats_segment.registerStage(name);
+    set_number_of_slots(slots);
 
     // Start the server thread
     server_thread = std::thread(&MatServer::serveMatFromBuffer, this);
@@ -42,40 +65,48 @@ MatServer::MatServer(const MatServer& orig) {
 
 MatServer::~MatServer() {
 
-    running = false;
-
-    // Make sure we unblock the server thread
-    for (int i = 0; i <= MATSERVER_BUFFER_SIZE; ++i) {
-        notifySelf();
+    // Wake the server thread if it is idle
+    {
+        std::lock_guard<std::mutex> lk(server_mutex);
+        running = false;
     }
+    serve_condition.notify_one();
+    space_condition.notify_all();
+
+    // Make sure we unblock the server thread if it is waiting on clients.
+    // It checks running before each publication, so one post is enough.
+    notifySelf();
 
     // Join the server thread back with the main one
     server_thread.join();
+    
+    stats_segment.release(stats);
+    stats_segment.releaseStage(stage);
 
     // Remove_shared_memory on object destruction
 
     shared_memory_object::remove(shmem_name.c_str());
-#ifndef NDEBUG
-    std::cout << "Shared memory \'" + shmem_name + "\' was deallocated.\n";
-#endif
+    if (!data_name.empty()) {
+        shared_memory_object::remove(data_name.c_str());
+    }
+    STLOG_DEBUG("Shared memory \'" + shmem_name + "\' was deallocated.\n");
 
 }
 
 void MatServer::createSharedMat(const cv::Mat& model) {
+    
+    createSharedMat(model.size(), model.type());
+}
 
-    data_size = model.total() * model.elemSize();
+void MatServer::createSharedMat(const cv::Size& size, int type) {
 
-    // TODO: Wrap in a named guard of some sort to protect the grow operation, which
-    // is not thread safe
+    // TODO: Wrap in a named guard of some sort
     try {
 
-        // Total amount of shared memory to allocated
-        //size_t total_bytes = data_size + sizeof (shmem::SharedCVMatHeader) + 1024;
-
-        // TODO: This is a complete HACK until I can figure out how to resize 
-        // the managed shared memory segment on the server side without 
-        // causing seg faults due to bad pointers on the client side.
-        size_t total_bytes = 1024e4;
+        // The header segment only holds synchronization and geometry, so its
+        // size does not depend on the frames. Clients use the same size, so
+        // whoever gets there first can create it.
+        size_t total_bytes = sizeof (shmem::SharedCVMatHeader) + 1024;
 
         // Define shared memory
         shared_memory = managed_shared_memory(open_or_create,
@@ -84,86 +115,389 @@ void MatServer::createSharedMat(const cv::Mat& model) {
 
         shared_mat_header = shared_memory.find_or_construct<shmem::SharedCVMatHeader>(shobj_name.c_str())();
 
-        // Check if client allocated, in which case we need to make room for
-        // the cv::Mat data
-        //        if (shared_memory.get_size() < total_bytes) {
-        //            size_t extra_bytes =  total_bytes - shared_memory.get_size();
-        //            managed_shared_memory::grow(shmem_name.c_str(), extra_bytes);
-        //            shared_memory = managed_shared_memory(open_only, shmem_name.c_str());
-        //            shared_mat_header = shared_memory.find_or_construct<shmem::SharedCVMatHeader>(shobj_name.c_str())();
-        //            shared_mat_header->remap_required = true;
-        //        } 
-        //        else {
-        //            shared_mat_header = shared_memory.find_or_construct<shmem::SharedCVMatHeader>(shobj_name.c_str())();
-        //        }
-
     } catch (interprocess_exception &ex) {
         std::cerr << ex.what() << '\n';
         exit(EXIT_FAILURE); // TODO: exit does not unwind the stack to take care of destructing shared memory objects
     }
 
-    shared_mat_header->buildHeader(shared_memory, model);
     shared_object_created = true;
+    
+    resizeSharedMat(size, type);
 }
 
-void MatServer::pushMat(const cv::Mat& mat) {
+/**
+ * Create a data segment sized for number_of_slots frames of the given size 
+ * and type and make it the current generation. Clients remap to the new segment the next time they 
+ * read. Clients still holding a view of an old frame keep their mapping of the
+ * old segment, which is freed once the last of them lets go.
+ */
+void MatServer::resizeSharedMat(const cv::Size& size, int type) {
+
+    data_size = size.area() * CV_ELEM_SIZE(type);
+    
+    size_t segment_bytes = shmem::SharedCVMatHeader::dataSegmentSize(size, type, number_of_slots);
+    std::string old_data_name = data_name;
+    
+    // Generations are only ever changed by this server
+    data_name = shmem::SharedCVMatHeader::dataSegmentName(name, shared_mat_header->get_generation() + 1);
+    
+    try {
 
-    // Push data onto ring buffer
-    mat_buffer.push(mat.clone());
+        shared_memory_object::remove(data_name.c_str());
+        shared_memory_object data_segment(create_only, data_name.c_str(), read_write);
+        data_segment.truncate(segment_bytes);
+        data_region = mapped_region(data_segment, read_write);
 
-#ifndef NDEBUG
-    std::cout << "Buffer count: " + std::to_string(mat_buffer.read_available()) + "\n";
-#endif
+    } catch (interprocess_exception &ex) {
+        std::cerr << ex.what() << '\n';
+        exit(EXIT_FAILURE); // TODO: exit does not unwind the stack to take care of destructing shared memory objects
+    }
 
-    // notify server thread that data is available
-    serve_condition.notify_one();
+    /* START CRITICAL SECTION */
+    shared_mat_header->mutex.wait();
+    shared_mat_header->buildHeader(size, type, number_of_slots);
+    shared_mat_header->mutex.post();
+    /* END CRITICAL SECTION */
+    
+    // Frames waiting for publication were in the old slots
+    {
+        std::lock_guard<std::mutex> lk(server_mutex);
+        slot_buffer.clear();
+    }
+    
+    // Clients only open the segment named by the current generation, so the
+    // old name can go now
+    if (!old_data_name.empty()) {
+        shared_memory_object::remove(old_data_name.c_str());
+    }
+
+    STLOG_DEBUG("Frame data for \'" + name + "\' is now " + std::to_string(segment_bytes) + " bytes in \'" + data_name + "\'.\n");
 }
 
-void MatServer::serveMatFromBuffer() {
+/**
+ * Copy a frame into shared memory and queue it for publication.
+ * @param mat The frame
+ * @param sample Identity of the frame. Sources stamp a new sample for each 
+ * frame; processing stages pass on the sample of the frame they processed.
+ */
+void MatServer::pushMat(const cv::Mat& mat, const shmem::Sample& sample) {
+
+    cv::Mat shared_mat;
+    
+    // All slots are queued or pinned by clients, so the frame is dropped
+    if (!acquireMat(shared_mat, mat.size(), mat.type())) {
+        return;
+    }
 
-    while (running) {
+    // This is the only copy of the frame and it happens outside of any 
+    // critical section.
+    mat.copyTo(shared_mat);
+    
+    commitMat(sample);
+}
+
+/**
+ * Get a free frame slot in shared memory to write into. Producers that can 
+ * render their output directly into the slot use this instead of pushMat to 
+ * avoid a copy. The slot must be handed back with commitMat before the next
+ * call to acquireMat or pushMat.
+ * @param mat Set to a writable view of the slot
+ * @param size Size of the frame that will be written
+ * @param type Type of the frame that will be written
+ * @return False if every slot is queued or pinned by a client, in which case
+ * the frame should be dropped.
+ */
+bool MatServer::acquireMat(cv::Mat& mat, const cv::Size& size, int type) {
+
+    // Create shared mat object if not done already
+    if (!shared_object_created) {
+        createSharedMat(size, type);
+    }
+
+    // Resolution or ROI changed. This throws away any slot that was acquired
+    // but not committed.
+    if (size != shared_mat_header->get_mat_size() ||
+        type != shared_mat_header->get_type()) {
+        resizeSharedMat(size, type);
+        mat_acquired = false;
+    }
 
-        // Proceed only if mat_buffer has data
+    // Find a slot that no client is looking at, unless the producer is still
+    // holding one from an earlier call
+    if (!mat_acquired && !acquireFreeSlot()) {
+        return false;
+    }
+
+    shared_mat_header->attachMatToSlot(data_region.get_address(), acquired.slot, mat);
+    return true;
+}
+
+/**
+ * Get a slot for the producer, applying the overflow policy if none is free.
+ * @return False if the new frame has to be dropped.
+ */
+bool MatServer::acquireFreeSlot() {
+    
+    while (true) {
+        
+        shared_mat_header->mutex.wait();
+        acquired.slot = shared_mat_header->acquireSlot();
+        acquired.generation = shared_mat_header->get_generation();
+        shared_mat_header->mutex.post();
+
+        if (acquired.slot >= 0) {
+            mat_acquired = true;
+            return true;
+        }
+        
         std::unique_lock<std::mutex> lk(server_mutex);
-        serve_condition.wait_for(lk, std::chrono::milliseconds(10));
+        
+        switch (overflow_policy) {
+            
+            case shmem::OverflowPolicy::BLOCK:
+                
+                // Slots are freed when the server publishes, which signals 
+                // space_condition, or when a client in another process lets
+                // go of one, which cannot. Check again periodically for the 
+                // latter.
+                space_condition.wait_for(lk, std::chrono::milliseconds(1));
+                if (!running) {
+                    return false;
+                }
+                break;
+                
+            case shmem::OverflowPolicy::DROP_NEWEST:
+                
+                stats->dropped = ++dropped_samples;
+                return false;
+                
+            case shmem::OverflowPolicy::DROP_OLDEST:
+                
+                // Take back the oldest frame that is still waiting to be
+                // published and write over it
+                stats->dropped = ++dropped_samples;
+                
+                if (slot_buffer.empty()) {
+                    
+                    // Every slot is held by a client, so nothing can be 
+                    // reclaimed
+                    return false;
+                }
+                
+                acquired = slot_buffer.front();
+                slot_buffer.pop_front();
+                stats->buffer_occupancy = slot_buffer.size();
+                mat_acquired = true;
+                return true;
+        }
+    }
+}
 
-        // Here we must attempt to clear the whole buffer before waiting again.
-        cv::Mat mat;
-        while (mat_buffer.pop(mat) && running) {
+/**
+ * Queue the slot obtained from acquireMat for publication.
+ * @param sample Identity of the frame that was written to the slot
+ */
+void MatServer::commitMat(const shmem::Sample& sample) {
+    
+    if (!mat_acquired) {
+        return;
+    }
+    
+    acquired.sample = sample;
+    mat_acquired = false;
+    
+    {
+        std::lock_guard<std::mutex> lk(server_mutex);
+        slot_buffer.push_back(acquired);
+        
+        stats->pushed++;
+        stats->buffer_occupancy = slot_buffer.size();
+    }
 
-            // Create shared mat object if not done already
-            if (!shared_object_created) {
-                createSharedMat(mat);
+    // Notify server thread that data is available. Because the push happened
+    // under the lock, the notification cannot fall between the server thread
+    // finding the buffer empty and starting to wait.
+    serve_condition.notify_one();
+}
+void MatServer::set_overflow_policy(shmem::OverflowPolicy value) {
+    
+    std::lock_guard<std::mutex> lk(server_mutex);
+    overflow_policy = value;
+}
+
+void MatServer::set_number_of_slots(int value) {
+    
+    if (shared_object_created) {
+        std::cerr << "The number of frame slots for \'" + name + "\' cannot change once frames are being served.\n";
+        return;
+    }
+    
+    number_of_slots = std::max(2, std::min(value, SHMEM_MAX_MAT_SLOTS));
+    stats->buffer_depth = number_of_slots;
+}
+
+void MatServer::serveMatFromBuffer() {
+
+    while (running) {
+
+        SlotTicket ticket;
+        
+        // Proceed only if slot_buffer has data. The lock is dropped before
+        // publishing so that pushMat never waits on clients.
+        {
+            std::unique_lock<std::mutex> lk(server_mutex);
+            serve_condition.wait(lk, [this] { 
+                return !slot_buffer.empty() || !running; 
+            });
+            
+            if (!running) {
+                break;
             }
+            
+            ticket = slot_buffer.front();
+            slot_buffer.pop_front();
+            stats->buffer_occupancy = slot_buffer.size();
+        }
 
+        {
             /* START CRITICAL SECTION */
             shared_mat_header->mutex.wait();
-
-            // Perform write in shared memory 
-            shared_mat_header->set_value(mat);
-
-            // Tell each client they can proceed
-            for (int i = 0; i < shared_mat_header->number_of_clients; ++i) {
-                shared_mat_header->read_barrier.post();
+            
+            // Slots written before a resize no longer exist
+            if (ticket.generation != shared_mat_header->get_generation()) {
+                shared_mat_header->mutex.post();
+                continue;
             }
 
+            // The frame was already written to the slot by pushMat, so 
+            // publication is just an index swap
+            shared_mat_header->publishSlot(ticket.slot, ticket.sample);
+            shared_mat_header->dropped_samples = dropped_samples;
+            
+            // Dead latest-only clients are never waited for, but they may
+            // still be pinning slots
+            stream_period.tick(shmem::Sample::nowInNs());
+            evictDeadClients();
+            
+            // Every lossless client must read this frame before the next one
+            // is published. Latest-only clients are never waited for.
+            bool wait_for_clients = shared_mat_header->clients.startPublication();
+            
+            // Clients are how far behind they were before this frame
+            recordClientStats();
+            
+            // Inside the critical section so that a client cannot pin the new
+            // slot while still seeing the old generation, and then read the
+            // same frame again when it sees the generation change
+            shared_mat_header->published.advance();
+
             shared_mat_header->mutex.post();
             /* END CRITICAL SECTION */
-
-            // Only wait if there is a client
-            if (shared_mat_header->number_of_clients) {
-                shared_mat_header->write_barrier.wait();
+            
+            logEvictions();
+            
+            // The previously published slot may be free now
+            space_condition.notify_one();
+
+            // Wake all clients with a single broadcast
+            shared_mat_header->published.wake();
+
+            stats->published++;
+
+            if (wait_for_clients) {
+                
+                int64_t wait_start_ns = shmem::Sample::nowInNs();
+                waitForClients();
+                stats->barrier_wait_ns += shmem::Sample::nowInNs() - wait_start_ns;
             }
+        }
+    }
+}
 
-            // Tell each client they can proceed now that the write_barrier
-            // has been passed
-            for (int i = 0; i < shared_mat_header->number_of_clients; ++i) {
-                shared_mat_header->new_data_barrier.post();
-            }
+/**
+ * Wait for all lossless clients to read the latest frame. Clients that die
+ * without detaching are evicted, so this returns within a bounded time even
+ * if one of them crashes.
+ */
+void MatServer::waitForClients() {
+    
+    while (!shared_mat_header->write_barrier.timed_wait(boost::get_system_time() +
+            boost::posix_time::milliseconds(SHMEM_LIVENESS_CHECK_MS))) {
+        
+        if (!running) {
+            return;
+        }
+        
+        /* START CRITICAL SECTION */
+        shared_mat_header->mutex.wait();
+        bool released = evictDeadClients();
+        shared_mat_header->mutex.post();
+        /* END CRITICAL SECTION */
+        
+        logEvictions();
+        
+        if (released) {
+            return;
         }
     }
 }
 
+/**
+ * Copy the state of each client into the stats segment, at most every 
+ * SHMEM_STATS_CLIENT_PERIOD_MS. Must be called with the header mutex held.
+ */
+void MatServer::recordClientStats() {
+    
+    int64_t now = shmem::Sample::nowInNs();
+    
+    if (now - last_client_stats_ns >= SHMEM_STATS_CLIENT_PERIOD_MS * 1000000LL) {
+        stats->recordClients(shared_mat_header->clients, shared_mat_header->published.get());
+        last_client_stats_ns = now;
+    }
+}
+
+/**
+ * Evict clients whose process has exited or whose lease has run out, and 
+ * free the slots they were holding. Must be called with the header mutex held.
+ * @return True if the server was only waiting on evicted clients.
+ */
+bool MatServer::evictDeadClients() {
+    
+    int64_t lease_ns = client_lease_ns > 0 ? client_lease_ns.load() : stream_period.lease_ns();
+    
+    return shared_mat_header->clients.evictDeadClients(lease_ns, shared_mat_header->published.get(), 
+            [this](shmem::ClientLease& lease) {
+        
+        shared_mat_header->releaseSlot(lease.pinned_slot, lease.pinned_generation);
+        evicted_pids[number_evicted++] = lease.pid;
+    });
+}
+
+/**
+ * Report the clients removed by evictDeadClients. Called after the header 
+ * mutex is released so that clients are not held up by logging.
+ */
+void MatServer::logEvictions() {
+    
+    for (int i = 0; i < number_evicted; ++i) {
+        STLOG_WARNING("Client " + std::to_string(evicted_pids[i]) + " of \'" + name + "\' stopped responding and was evicted.\n");
+    }
+    
+    number_evicted = 0;
+}
+
+/**
+ * @param value How long a client may go without reading or waiting to read 
+ * before the server stops waiting for it. Clients whose process has exited are
+ * evicted within a few SHMEM_LIVENESS_CHECK_MS regardless. Lossless clients 
+ * that take longer than this to process a frame need a longer lease. The 
+ * default is SHMEM_LEASE_PERIODS frame periods.
+ */
+void MatServer::set_client_lease(std::chrono::milliseconds value) {
+    
+    client_lease_ns = std::max<int64_t>(SHMEM_MIN_CLIENT_LEASE_MS * 1000000LL, value.count() * 1000000LL);
+}
+
 void MatServer::notifySelf() {
 
     if (shared_object_created) {
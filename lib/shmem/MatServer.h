@@ -18,34 +18,54 @@
 #define	MATSERVER_H
 
 #include <atomic>
+#include <chrono>
+#include <deque>
 #include <string>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 
 #include <boost/interprocess/managed_shared_memory.hpp>
-#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <opencv2/core/mat.hpp>
 
+#include "OverflowPolicy.h"
+#include "Sample.h"
 #include "SharedCVMatHeader.h"
+#include "StreamStats.h"
 
-#define MATSERVER_BUFFER_SIZE 100
+#define MATSERVER_DEFAULT_NUM_SLOTS 4
 
 // TODO: Find a why to integrate this with the must much general purpose SMServer
 class MatServer {
     
 public:
-    MatServer(const std::string sink_name);
+    MatServer(const std::string sink_name, 
+              int slots = MATSERVER_DEFAULT_NUM_SLOTS,
+              shmem::OverflowPolicy policy = shmem::OverflowPolicy::DROP_NEWEST);
     MatServer(const MatServer& orig);
     virtual ~MatServer();
     
     void createSharedMat(const cv::Mat& model); 
-    void pushMat(const cv::Mat& mat);
+    void pushMat(const cv::Mat& mat, const shmem::Sample& sample);
+    
+    // Zero-copy alternative to pushMat: write the frame straight into a slot
+    bool acquireMat(cv::Mat& mat, const cv::Size& size, int type);
+    void commitMat(const shmem::Sample& sample);
 
     // Accessors  // TODO: Assess whether you really need these and get rid of them if not. 
     bool is_running(void) { return running; };
     void set_running(bool value) { running = value; } 
     std::string get_name(void) { return name; }
+    uint32_t get_stage(void) { return stage; } // Identifies this stage in sample stamps
+    void set_number_of_slots(int value);
+    int get_number_of_slots(void) { return number_of_slots; }
+    void set_overflow_policy(shmem::OverflowPolicy value);
+    void set_client_lease(std::chrono::milliseconds value);
+    
+    // Frames that were pushed but never published because no slot was free.
+    // Also visible to clients through the shared header.
+    uint64_t get_dropped_samples(void) { return dropped_samples; }
     
     void set_world_coords_valid(bool value) { shared_mat_header->world_coords_valid = value; }
     void set_xy_origin_in_px(cv::Point2f value) { shared_mat_header->xy_origin_in_px = value; }
@@ -57,22 +77,67 @@ private:
     // Name of this server
     std::string name;
     
-    // Buffer
-    boost::lockfree::spsc_queue<cv::Mat, boost::lockfree::capacity<MATSERVER_BUFFER_SIZE> > mat_buffer;
+    // A slot that has been written but not yet published
+    struct SlotTicket {
+        int slot;
+        uint32_t generation;
+        shmem::Sample sample;
+    };
+    
+    // Buffer of shared memory slots that have been written but not yet 
+    // published, guarded by server_mutex. Its depth is bounded by the number
+    // of slots.
+    std::deque<SlotTicket> slot_buffer;
+    shmem::OverflowPolicy overflow_policy;
+    std::atomic<uint64_t> dropped_samples;
+    
+    // Clients that go this long without reading or waiting to read are 
+    // evicted, as are clients whose process has exited. Zero means 
+    // SHMEM_LEASE_PERIODS periods of the stream.
+    std::atomic<int64_t> client_lease_ns;
+    shmem::StreamPeriod stream_period;
+    
+    // Clients evicted while the header mutex was held, logged once it is not
+    pid_t evicted_pids[SHMEM_MAX_CLIENTS];
+    int number_evicted;
+    
+    // Live counters in the well known stats segment
+    shmem::StatsSegment stats_segment;
+    shmem::StreamStats* stats;
+    int64_t last_client_stats_ns;
+    uint32_t stage;
     
     // Server threading
     std::thread server_thread;
     std::mutex server_mutex;
-    std::condition_variable serve_condition;
+    std::condition_variable serve_condition; // slot_buffer has data
+    std::condition_variable space_condition; // A slot may have been freed
     std::atomic<bool> running; // Server running, can be accessed from multiple threads
     shmem::SharedCVMatHeader* shared_mat_header;
     bool shared_object_created;
 
     int data_size; // Size of raw mat data in bytes
+    int number_of_slots; // Number of frame slots in shared memory
+    
+    // Slot handed to the producer by acquireMat and not yet committed
+    SlotTicket acquired;
+    bool mat_acquired;
     
     const std::string shmem_name, shobj_name;
     boost::interprocess::managed_shared_memory shared_memory; 
     
+    // Frame data segment of the current generation
+    std::string data_name;
+    boost::interprocess::mapped_region data_region;
+    
+    void createSharedMat(const cv::Size& size, int type);
+    void resizeSharedMat(const cv::Size& size, int type);
+    bool acquireFreeSlot(void);
+    bool evictDeadClients(void);
+    void logEvictions(void);
+    void recordClientStats(void);
+    void waitForClients(void);
+    
     /**
      * Synchronized shared memory publication.
      * @param mat
@@ -0,0 +1,46 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef OBJECTSERVER_H
+#define	OBJECTSERVER_H
+
+#include <cstdint>
+#include <string>
+
+#include "OverflowPolicy.h"
+
+namespace shmem {
+
+    /**
+     * Server side of an object stream, independent of the shared object that
+     * carries it. Lets a component pick its transport at run time.
+     */
+    template<class T>
+    class ObjectServer {
+    public:
+        virtual ~ObjectServer() { }
+
+        virtual void pushObject(T value) = 0;
+        virtual void set_running(bool value) = 0;
+        virtual std::string get_name(void) = 0;
+        virtual uint32_t get_stage(void) = 0;
+        virtual void set_overflow_policy(OverflowPolicy value) = 0;
+        virtual void set_buffer_depth(size_t value) = 0;
+        virtual uint64_t get_dropped_samples(void) = 0;
+    };
+}
+
+#endif	/* OBJECTSERVER_H */
@@ -0,0 +1,88 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef OVERFLOWPOLICY_H
+#define	OVERFLOWPOLICY_H
+
+#include <iostream>
+#include <string>
+
+#include "../cpptoml/cpptoml.h"
+
+namespace shmem {
+
+    /**
+     * What a server does with a new sample when its buffer of samples waiting
+     * to be published is full.
+     */
+    enum class OverflowPolicy {
+        
+        // Make the producer wait until there is room. Nothing is lost, but a
+        // slow client will slow the producer down, all the way to the camera.
+        BLOCK,
+        
+        // Discard the new sample. The buffer keeps the oldest samples.
+        DROP_NEWEST,
+        
+        // Discard the oldest waiting sample to make room for the new one. 
+        // This keeps latency bounded when clients fall behind.
+        DROP_OLDEST
+    };
+    
+    /**
+     * Parse the overflow_policy configuration value: "block", "drop_newest" 
+     * or "drop_oldest".
+     * @return False if value is not a known policy, in which case policy is 
+     * not changed.
+     */
+    inline bool parseOverflowPolicy(const std::string& value, OverflowPolicy& policy) {
+        
+        if (value == "block") {
+            policy = OverflowPolicy::BLOCK;
+        } else if (value == "drop_newest") {
+            policy = OverflowPolicy::DROP_NEWEST;
+        } else if (value == "drop_oldest") {
+            policy = OverflowPolicy::DROP_OLDEST;
+        } else {
+            return false;
+        }
+        
+        return true;
+    }
+    
+    /**
+     * Read an optional overflow_policy key from a configuration table. An 
+     * unknown value is reported and ignored.
+     * @return True if policy was set from the table.
+     */
+    inline bool parseOverflowPolicy(const cpptoml::table& config, OverflowPolicy& policy) {
+        
+        if (!config.contains("overflow_policy")) {
+            return false;
+        }
+        
+        std::string value = *config.get_as<std::string>("overflow_policy");
+        
+        if (!parseOverflowPolicy(value, policy)) {
+            std::cerr << "Unknown overflow_policy \"" + value + "\". Keeping the default." << std::endl;
+            return false;
+        }
+        
+        return true;
+    }
+}
+
+#endif	/* OVERFLOWPOLICY_H */
@@ -19,6 +19,8 @@
 
 #include <opencv2/core/mat.hpp>
 
+#include "Sample.h"
+
 namespace shmem {
     
     typedef cv::Point3f Position3D;
@@ -27,6 +29,9 @@ namespace shmem {
 
     struct Position {
         
+        // The sample this position was measured from
+        Sample sample;
+        
         // Used to get world coordinates from image
         bool world_coords_valid = false;
         cv::Point3f xyz_origin_in_px;
@@ -0,0 +1,39 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef QOS_H
+#define	QOS_H
+
+namespace shmem {
+
+    /**
+     * How a client wants to receive data from a server. 
+     */
+    enum class QoS {
+        
+        // Read every sample. The server waits until this client has read
+        // before publishing the next sample.
+        LOSSLESS,
+        
+        // Read the newest sample available. The server never waits for this
+        // client, which may skip samples if it is slow. Use this for display 
+        // and other consumers that must not throttle the processing chain.
+        LATEST_ONLY
+    };
+}
+
+#endif	/* QOS_H */
+
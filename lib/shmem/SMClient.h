@@ -18,9 +18,11 @@
 #define	SMCLIENT_H
 
 #include <string>
-#include <boost/thread/thread_time.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
 
+#include "../log/Log.h"
+#include "ObjectClient.h"
+#include "QoS.h"
 #include "SyncSharedMemoryObject.h"
 
 namespace shmem {
@@ -28,17 +30,26 @@ namespace shmem {
     namespace bip = boost::interprocess;
 
     template<class T, template <typename IOType> class SharedMemType = shmem::SyncSharedMemoryObject>
-    class SMClient {
+    class SMClient : public ObjectClient<T> {
     public:
         SMClient(std::string source_name);
         SMClient(const SMClient& orig);
         virtual ~SMClient();
 
         // Find shared object
-        int findSharedObject(void);
+        int findSharedObject(QoS qos = QoS::LOSSLESS);
 
         // Read the object value
         bool getSharedObject(T& value);
+        
+        std::string get_name(void) {
+            return name;
+        }
+        
+        // Samples the server dropped because its buffer was full
+        uint64_t get_server_dropped_samples(void) {
+            return shared_object->get_dropped_samples();
+        }
 
     private:
 
@@ -47,7 +58,7 @@ namespace shmem {
         std::string name;
         std::string shmem_name, shobj_name;
         bool shared_object_found;
-        bool read_barrier_passed;
+        typename SharedMemType<T>::ReadState read_state;
         bip::managed_shared_memory shared_memory;
 
         void detachFromShmem(void);
@@ -57,9 +68,8 @@ namespace shmem {
     SMClient<T, SharedMemType>::SMClient(std::string source_name) :
     name(source_name)
     , shmem_name(source_name + "_sh_mem")
-    , shobj_name(source_name + "_sh_obj")
-    , shared_object_found(false)
-    , read_barrier_passed(false) {
+    , shobj_name(SharedMemType<T>::objectName(source_name))
+    , shared_object_found(false) {
     }
 
     template<class T, template <typename> class SharedMemType>
@@ -73,7 +83,7 @@ namespace shmem {
     }
 
     template<class T, template <typename> class SharedMemType>
-    int SMClient<T, SharedMemType>::findSharedObject() {
+    int SMClient<T, SharedMemType>::findSharedObject(QoS qos) {
 
         int client_num;
 
@@ -96,10 +106,7 @@ namespace shmem {
 
         // Make sure everyone using this shared memory knows that another client
         // has joined
-        shared_object->mutex.wait();
-        shared_object->number_of_clients++;
-        client_num = shared_object->number_of_clients;
-        shared_object->mutex.post();
+        client_num = shared_object->addClient(qos, read_state);
 
         return client_num;
     }
@@ -119,44 +126,7 @@ namespace shmem {
     template<class T, template <typename> class SharedMemType>
     bool SMClient<T, SharedMemType>::getSharedObject(T& value) {
 
-        boost::system_time timeout =
-                boost::get_system_time() + boost::posix_time::milliseconds(100);
-
-        if (!read_barrier_passed) {
-
-            if (!shared_object->read_barrier.timed_wait(timeout)) {
-                return false;
-            }
-
-            // Write down that we made it past the read_barrier in case the
-            // new_data_barrier times out.
-            read_barrier_passed = true;
-
-            /* START CRITICAL SECTION */
-            shared_object->mutex.wait();
-
-            value = shared_object->get_value();
-
-            // Now that this client has finished its read, update the count
-            shared_object->client_read_count++;
-
-            // If all clients have read, signal the write barrier
-            if (shared_object->client_read_count == shared_object->number_of_clients) {
-                shared_object->write_barrier.post();
-                shared_object->client_read_count = 0;
-            }
-
-            shared_object->mutex.post();
-            /* END CRITICAL SECTION */
-        }
-
-        if (!shared_object->new_data_barrier.timed_wait(timeout)) {
-            return false;
-        }
-
-        // Reset the read_barrier_passed switch
-        read_barrier_passed = false;
-        return true;
+        return shared_object->consume(value, read_state);
     }
 
     template<class T, template <typename> class SharedMemType>
@@ -165,13 +135,9 @@ namespace shmem {
         if (shared_object_found) {
 
             // Make sure nobody is going to wait on a disposed object
-            shared_object->mutex.wait();
-            shared_object->number_of_clients--;
-            shared_object->mutex.post();
+            shared_object->removeClient(read_state);
 
-#ifndef NDEBUG
-            std::cout << "Number of clients in \'" + shmem_name + "\' was decremented.\n";
-#endif
+            STLOG_DEBUG("Number of clients in \'" + shmem_name + "\' was decremented.\n");
 
         }
     }
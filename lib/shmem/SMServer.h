@@ -17,27 +17,36 @@
 #ifndef SMSERVER_H
 #define	SMSERVER_H
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <deque>
 #include <string>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
-#include <boost/lockfree/spsc_queue.hpp>
 
+#include "../log/Log.h"
+#include "ClientTable.h"
+#include "ObjectServer.h"
+#include "OverflowPolicy.h"
+#include "StreamStats.h"
 #include "SyncSharedMemoryObject.h"
 
-#define SMSERVER_BUFFER_SIZE 100
+#define SMSERVER_DEFAULT_BUFFER_DEPTH 100
 
 namespace shmem {
 
     namespace bip = boost::interprocess;
 
     template<class T, template <typename> class SharedMemType = shmem::SyncSharedMemoryObject>
-    class SMServer {
+    class SMServer : public ObjectServer<T> {
     public:
-        SMServer(std::string sink_name);
+        SMServer(std::string sink_name, 
+                 OverflowPolicy policy = OverflowPolicy::DROP_NEWEST,
+                 size_t depth = SMSERVER_DEFAULT_BUFFER_DEPTH);
         SMServer(const SMServer& orig);
         virtual ~SMServer();
 
@@ -54,19 +63,54 @@ namespace shmem {
         void set_running(bool value) {
             running = value;
         }
+        
+        std::string get_name(void) {
+            return name;
+        }
+        
+        // Identifies the stage that publishes here in sample stamps
+        uint32_t get_stage(void) {
+            return stage;
+        }
+        
+        void set_overflow_policy(OverflowPolicy value);
+        void set_buffer_depth(size_t value);
+        void set_client_lease(std::chrono::milliseconds value);
+        
+        // Samples that were pushed but never published because the buffer
+        // was full. Also visible to clients through the shared object.
+        uint64_t get_dropped_samples(void) {
+            return dropped_samples;
+        }
 
     private:
 
         // Name of this server
         std::string name;
 
-        // Buffer
-        boost::lockfree::spsc_queue<T, boost::lockfree::capacity<SMSERVER_BUFFER_SIZE> > buffer;
+        // Samples waiting to be published, guarded by server_mutex
+        std::deque<T> buffer;
+        size_t buffer_depth;
+        OverflowPolicy overflow_policy;
+        std::atomic<uint64_t> dropped_samples;
+        
+        // Clients that go this long without reading or waiting to read are 
+        // evicted, as are clients whose process has exited. Zero means 
+        // SHMEM_LEASE_PERIODS periods of the stream.
+        std::atomic<int64_t> client_lease_ns;
+        StreamPeriod stream_period;
+
+        // Live counters in the well known stats segment
+        StatsSegment stats_segment;
+        StreamStats* stats;
+        int64_t last_client_stats_ns;
+        uint32_t stage;
 
         // Server threading
         std::thread server_thread;
         std::mutex server_mutex;
-        std::condition_variable serve_condition;
+        std::condition_variable serve_condition; // Buffer has data
+        std::condition_variable space_condition; // Buffer has room
         std::atomic<bool> running; // Server running
 
         // Shared memory and managed object names
@@ -82,12 +126,21 @@ namespace shmem {
     };
 
     template<class T, template <typename> class SharedMemType>
-    SMServer<T, SharedMemType>::SMServer(std::string sink_name) :
+    SMServer<T, SharedMemType>::SMServer(std::string sink_name, OverflowPolicy policy, size_t depth) :
     name(sink_name)
+    , buffer_depth(depth > 0 ? depth : 1)
+    , overflow_policy(policy)
+    , dropped_samples(0)
+    , client_lease_ns(0)
+    , last_client_stats_ns(0)
+    , running(true)
     , shmem_name(sink_name + "_sh_mem")
-    , shobj_name(sink_name + "_sh_obj")
-    , shared_object_created(false)
-    , running(true) {
+    , shobj_name(SharedMemType<T>::objectName(sink_name))
+    , shared_object_created(false) {
+
+        stats = stats_segment.claim(name, "SMServer");
+        stage = stats_segment.registerStage(name);
+        stats->buffer_depth = buffer_depth;
 
         // Start the server thread
         server_thread = std::thread(&SMServer<T, SharedMemType>::serveFromBuffer, this);
@@ -100,21 +153,31 @@ namespace shmem {
     template<class T, template <typename> class SharedMemType>
     SMServer<T, SharedMemType>::~SMServer() {
 
-        running = false;
-
-        // Make sure we unblock the server thread
-        for (int i = 0; i <= SMSERVER_BUFFER_SIZE; ++i) {
-            notifySelf();
+        // Wake the server thread if it is idle
+        {
+            std::lock_guard<std::mutex> lk(server_mutex);
+            running = false;
         }
+        serve_condition.notify_one();
+        space_condition.notify_all();
+
+        // Make sure we unblock the server thread if it is waiting on clients.
+        // It checks running before each publication, so one post is enough.
+        notifySelf();
 
         // Join the server thread back with the main one
         server_thread.join();
+        
+        stats_segment.release(stats);
+        stats_segment.releaseStage(stage);
 
-        // Remove_shared_memory on object destruction
-        bip::shared_memory_object::remove(shmem_name.c_str());
-#ifndef NDEBUG
-        std::cout << "Shared memory \'" + shmem_name + "\' was deallocated.\n";
-#endif
+        // Remove_shared_memory on object destruction. A server that never
+        // published, e.g. one replaced after configuration, leaves the segment
+        // to the clients that may already have mapped it.
+        if (shared_object_created) {
+            bip::shared_memory_object::remove(shmem_name.c_str());
+            STLOG_DEBUG("Shared memory \'" + shmem_name + "\' was deallocated.\n");
+        }
     }
 
     template<class T, template <typename> class SharedMemType>
@@ -143,14 +206,39 @@ namespace shmem {
     template<class T, template <typename> class SharedMemType>
     void SMServer<T, SharedMemType>::pushObject(T value) {
 
-        // Push data onto ring buffer
-        buffer.push(value);
+        {
+            std::unique_lock<std::mutex> lk(server_mutex);
 
-#ifndef NDEBUG
-        std::cout << "Buffer count: " + std::to_string(buffer.read_available()) + "\n";
-#endif
+            if (buffer.size() >= buffer_depth) {
 
-        // notify server thread that data is available
+                switch (overflow_policy) {
+                    case OverflowPolicy::BLOCK:
+                        space_condition.wait(lk, [this] {
+                            return buffer.size() < buffer_depth || !running;
+                        });
+                        break;
+
+                    case OverflowPolicy::DROP_NEWEST:
+                        stats->dropped = ++dropped_samples;
+                        return;
+
+                    case OverflowPolicy::DROP_OLDEST:
+                        buffer.pop_front();
+                        stats->dropped = ++dropped_samples;
+                        break;
+                }
+            }
+
+            // Push data onto buffer
+            buffer.push_back(value);
+            
+            stats->pushed++;
+            stats->buffer_occupancy = buffer.size();
+        }
+
+        // Notify server thread that data is available. Because the push 
+        // happened under the lock, the notification cannot fall between the
+        // server thread finding the buffer empty and starting to wait.
         serve_condition.notify_one();
 
     }
@@ -160,50 +248,87 @@ namespace shmem {
 
         while (running) {
 
-            // Proceed only if mat_buffer has data
-            std::unique_lock<std::mutex> lk(server_mutex);
-            serve_condition.wait_for(lk, std::chrono::milliseconds(10));
-
             T value;
-            while (buffer.pop(value) && running) {
 
-                if (!shared_object_created) {
-                    createSharedObject();
+            // Proceed only if buffer has data. The lock is dropped before
+            // publishing so that pushObject never waits on clients.
+            {
+                std::unique_lock<std::mutex> lk(server_mutex);
+                serve_condition.wait(lk, [this] {
+                    return !buffer.empty() || !running;
+                });
+
+                if (!running) {
+                    break;
                 }
 
-                /* START CRITICAL SECTION */
-                shared_object->mutex.wait();
+                value = buffer.front();
+                buffer.pop_front();
+                stats->buffer_occupancy = buffer.size();
+            }
+            space_condition.notify_one();
 
-                // Perform write in shared memory 
-                shared_object->set_value(value);
+            if (!shared_object_created) {
+                createSharedObject();
+            }
 
-                shared_object->mutex.post();
-                /* END CRITICAL SECTION */
+            // Synchronization with clients is up to the shared object type
+            shared_object->set_dropped_samples(dropped_samples);
+            stream_period.tick(Sample::nowInNs());
+            shared_object->set_client_lease(client_lease_ns > 0 ? client_lease_ns.load() : stream_period.lease_ns());
+            
+            // Clients are how far behind they were before this sample
+            int64_t now_ns = Sample::nowInNs();
+            if (now_ns - last_client_stats_ns >= SHMEM_STATS_CLIENT_PERIOD_MS * 1000000LL) {
+                shared_object->recordClientStats(*stats);
+                last_client_stats_ns = now_ns;
+            }
+            
+            // Returns once lossless clients have read the sample
+            int64_t wait_ns = shared_object->publish(value);
+            
+            stats->published++;
+            stats->barrier_wait_ns += wait_ns;
+        }
+    }
 
-                // Tell each client they can proceed
-                for (int i = 0; i < shared_object->number_of_clients; ++i) {
-                    shared_object->read_barrier.post();
-                }
+    template<class T, template <typename> class SharedMemType>
+    void SMServer<T, SharedMemType>::set_overflow_policy(OverflowPolicy value) {
 
-                // Only wait if there is a client
-                if (shared_object->number_of_clients) {
-                    shared_object->write_barrier.wait();
-                }
+        std::lock_guard<std::mutex> lk(server_mutex);
+        overflow_policy = value;
+    }
 
-                // Tell each client they can proceed now that the write_barrier
-                // has been passed
-                for (int i = 0; i < shared_object->number_of_clients; ++i) {
-                    shared_object->new_data_barrier.post();
-                }
-            }
+    template<class T, template <typename> class SharedMemType>
+    void SMServer<T, SharedMemType>::set_buffer_depth(size_t value) {
+
+        {
+            std::lock_guard<std::mutex> lk(server_mutex);
+            buffer_depth = value > 0 ? value : 1;
+            stats->buffer_depth = buffer_depth;
         }
+        
+        // A deeper buffer may let a blocked producer continue
+        space_condition.notify_all();
+    }
+
+    /**
+     * @param value How long a client may go without reading or waiting to 
+     * read before the server stops waiting for it. Clients whose process has 
+     * exited are evicted within a few SHMEM_LIVENESS_CHECK_MS regardless. 
+     * The default is SHMEM_LEASE_PERIODS sample periods.
+     */
+    template<class T, template <typename> class SharedMemType>
+    void SMServer<T, SharedMemType>::set_client_lease(std::chrono::milliseconds value) {
+
+        client_lease_ns = std::max<int64_t>(SHMEM_MIN_CLIENT_LEASE_MS * 1000000LL, value.count() * 1000000LL);
     }
 
     template<class T, template <typename> class SharedMemType>
     void SMServer<T, SharedMemType>::notifySelf() {
 
         if (shared_object_created) {
-            shared_object->write_barrier.post();
+            shared_object->releaseServer();
         }
     }
 } // namespace shmem 
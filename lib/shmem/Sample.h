@@ -0,0 +1,109 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef SAMPLE_H
+#define	SAMPLE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+// Stages a sample can pass through before its stamps stop being recorded
+#define SHMEM_MAX_STAGE_STAMPS 8
+
+// Stage names registered on a machine. Stamps of stages that could not be 
+// registered carry SHMEM_UNKNOWN_STAGE.
+#define SHMEM_MAX_STAGES 64
+#define SHMEM_UNKNOWN_STAGE 0xFFFFFFFFu
+
+namespace shmem {
+
+    /**
+     * Time a sample spent in one processing stage. Stages are named after the
+     * server they publish to, and identified by the index of that name in the
+     * stats segment (see StatsSegment::registerStage).
+     */
+    struct StageStamp {
+        
+        int64_t enter_ns;       // Input obtained by the stage
+        uint32_t stage;
+        uint32_t processing_ns; // Until the output was handed to the server
+        
+        int64_t exit_ns(void) const { return enter_ns + processing_ns; }
+    };
+
+    /**
+     * Identity of a sample as it moves through the processing chain. Cameras 
+     * stamp each frame they grab and every stage copies the stamp of its input
+     * onto its output, so that streams can be joined by sample number and 
+     * latency can be measured against the capture time. Each stage also adds
+     * a stamp of its own so that latency can be broken down by stage.
+     */
+    struct Sample {
+        
+        // Monotonically increasing from 1. Zero means the sample was never
+        // stamped.
+        uint64_t number = 0;
+        
+        // steady_clock time at capture, in nanoseconds. Only comparable 
+        // between processes on the same machine.
+        int64_t capture_time_ns = 0;
+        
+        // Stages this sample has passed through, in order
+        uint32_t number_of_stages = 0;
+        StageStamp stages[SHMEM_MAX_STAGE_STAMPS];
+        
+        // Stamp the next sample in a stream as captured now
+        void stampNext(void) {
+            stampNext(nowInNs());
+        }
+        
+        // Stamp the next sample in a stream as captured at time_ns, e.g. a 
+        // recording's media time mapped onto steady_clock
+        void stampNext(int64_t time_ns) {
+            number++;
+            capture_time_ns = time_ns;
+            number_of_stages = 0;
+        }
+        
+        /**
+         * Record that a stage which obtained its input at enter_ns is handing
+         * its output on now. Stages beyond SHMEM_MAX_STAGE_STAMPS are not 
+         * recorded. Processing times saturate at about 4 s.
+         * @param stage The stage's index, usually from its server's get_stage
+         */
+        void addStage(uint32_t stage, int64_t enter_ns) {
+            
+            if (number_of_stages >= SHMEM_MAX_STAGE_STAMPS) {
+                return;
+            }
+            
+            int64_t processing_ns = std::max<int64_t>(0, nowInNs() - enter_ns);
+            
+            StageStamp& stamp = stages[number_of_stages++];
+            stamp.enter_ns = enter_ns;
+            stamp.stage = stage;
+            stamp.processing_ns = static_cast<uint32_t>(std::min<int64_t>(processing_ns, UINT32_MAX));
+        }
+        
+        static int64_t nowInNs(void) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    };
+}
+
+#endif	/* SAMPLE_H */
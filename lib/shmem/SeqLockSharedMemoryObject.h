@@ -0,0 +1,197 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef SEQLOCKSHAREDMEMORYOBJECT_H
+#define	SEQLOCKSHAREDMEMORYOBJECT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "QoS.h"
+#include "StreamStats.h"
+
+namespace shmem {
+
+    /**
+     * Latest-value shared object guarded by a sequence lock. The server never
+     * waits on its clients and clients never block the server: a reader
+     * copies the value and retries if the sequence number changed while it
+     * was copying. Clients may therefore skip values if they read more 
+     * slowly than the server writes.
+     * 
+     * T is copied with memcpy, so it must be a small, trivially copyable type
+     * such as shmem::Position.
+     */
+    template <class T>
+    class SeqLockSharedMemoryObject {
+        
+        static_assert(std::is_trivially_copyable<T>::value,
+                "SeqLockSharedMemoryObject copies T with memcpy");
+        
+    public:
+        
+        /**
+         * Name of the object within a stream's segment. Differs from that of
+         * the synchronous transport so that a server and client that disagree
+         * on the transport never map one object as two types.
+         */
+        static std::string objectName(const std::string& stream_name) {
+            return stream_name + "_sh_seqlock";
+        }
+
+        SeqLockSharedMemoryObject(void) :
+          sequence(0)
+        , number_of_clients(0)
+        , dropped_samples(0) { }
+        
+        // Per-client read progress, kept by the client process
+        struct ReadState {
+            uint64_t version = 0;
+        };
+        
+        /**
+         * Register a new client. Every client of this object is latest-only,
+         * so qos is ignored.
+         * @return The number of clients, including this one.
+         */
+        int addClient(QoS qos, ReadState& state) {
+            return ++number_of_clients;
+        }
+        
+        void removeClient(const ReadState& state) {
+            --number_of_clients;
+        }
+        
+        /**
+         * Server side: write value. Never blocks.
+         * @return Nanoseconds spent waiting for clients, always 0.
+         */
+        int64_t publish(const T& value) {
+            
+            // Odd sequence numbers mark a write in progress
+            uint64_t seq = sequence.load(std::memory_order_relaxed);
+            sequence.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            
+            std::memcpy(&object, &value, sizeof(T));
+            
+            sequence.store(seq + 2, std::memory_order_release);
+            
+            return 0;
+        }
+        
+        /**
+         * Client side: read the latest value if it is newer than the last one
+         * this client has read.
+         * @return False if no new value was published within the timeout.
+         */
+        bool consume(T& value, ReadState& state) {
+            
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+            int spins = 0;
+            
+            while (true) {
+                
+                uint64_t seq_start = sequence.load(std::memory_order_acquire);
+                
+                // Wait for a new, completely written value. Spin briefly 
+                // since new positions usually arrive shortly, then back off
+                // so idle readers do not burn a core.
+                if ((seq_start & 1) || version(seq_start) == state.version) {
+                    
+                    if (std::chrono::steady_clock::now() > deadline) {
+                        return false;
+                    }
+                    
+                    if (++spins > SEQLOCK_SPIN_COUNT) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    }
+                    
+                    continue;
+                }
+
+                std::memcpy(&value, &object, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                
+                // If the server wrote during the copy, the value may be torn
+                if (sequence.load(std::memory_order_relaxed) == seq_start) {
+                    state.version = version(seq_start);
+                    return true;
+                }
+            }
+        }
+        
+        /**
+         * Servers never wait on clients, so there is nothing to unblock.
+         */
+        void releaseServer(void) { }
+        
+        /**
+         * Clients hold nothing the server waits for, so they need no lease.
+         */
+        void set_client_lease(int64_t value_ns) { }
+        
+        /**
+         * Clients do not report their reads, so only their number is known.
+         */
+        void recordClientStats(StreamStats& stats) {
+            
+            stats.number_of_clients = 0;
+            stats.number_of_latest_only_clients = number_of_clients.load();
+            stats.number_of_client_stats = 0;
+        }
+        
+        /**
+         * Samples the server dropped before publication because its buffer
+         * was full.
+         */
+        void set_dropped_samples(uint64_t value) { 
+            dropped_samples.store(value, std::memory_order_relaxed); 
+        }
+        
+        uint64_t get_dropped_samples(void) { 
+            return dropped_samples.load(std::memory_order_relaxed); 
+        }
+        
+        /**
+         * Number of values published so far.
+         */
+        uint64_t get_version(void) {
+            return version(sequence.load(std::memory_order_acquire));
+        }
+
+    private:
+        
+        static const int SEQLOCK_SPIN_COUNT = 1000;
+        
+        static uint64_t version(uint64_t seq) { return seq >> 1; }
+        
+        // Must be lock-free (and therefore address-free) to work across 
+        // processes, which holds for 64-bit atomics on x86-64
+        std::atomic<uint64_t> sequence;
+        std::atomic<int> number_of_clients;
+        std::atomic<uint64_t> dropped_samples;
+        T object;
+    };
+}
+
+#endif	/* SEQLOCKSHAREDMEMORYOBJECT_H */
+
@@ -16,37 +16,108 @@
 
 #include "SharedCVMatHeader.h"
 
+#include <algorithm>
 #include <opencv2/core/mat.hpp>
 
+// Slots start on cache line boundaries
+#define SHAREDMAT_SLOT_ALIGNMENT 64
+
 namespace shmem {
     
     SharedCVMatHeader::SharedCVMatHeader() :
       mutex(1)
     , write_barrier(0)
-    , read_barrier(0)
-    , new_data_barrier(0)
-    , number_of_clients(0)
-    , client_read_count(0)
+    , dropped_samples(0)
     , world_coords_valid(false)
     , worldunits_per_px_x(0)
-    , worldunits_per_px_y(0) { }
+    , worldunits_per_px_y(0)
+    , type(0)
+    , generation(0)
+    , slot_bytes(0)
+    , number_of_slots(0)
+    , latest_slot(-1) { }
 
-    void SharedCVMatHeader::set_value(const cv::Mat& mat) {
-        memcpy(data_ptr, mat.data, data_size_in_bytes);
+    static size_t alignedFrameBytes(const cv::Size& size, int type) {
+        
+        size_t bytes = size.area() * CV_ELEM_SIZE(type);
+        return (bytes + SHAREDMAT_SLOT_ALIGNMENT - 1) / SHAREDMAT_SLOT_ALIGNMENT * SHAREDMAT_SLOT_ALIGNMENT;
     }
 
-    void SharedCVMatHeader::buildHeader(boost::interprocess::managed_shared_memory& shared_mem, const cv::Mat& model) {
-
-        data_size_in_bytes = model.total() * model.elemSize();
-        data_ptr = shared_mem.allocate(data_size_in_bytes);
-        mat_size = model.size();
-        type = model.type();
-        handle = shared_mem.get_handle_from_address(data_ptr);
+    int SharedCVMatHeader::buildHeader(const cv::Size& size, int mat_type, int requested_slots) {
 
+        mat_size = size;
+        type = mat_type;
+        slot_bytes = alignedFrameBytes(size, mat_type);
+        
+        number_of_slots = std::min(requested_slots, SHMEM_MAX_MAT_SLOTS);
+        latest_slot = -1;
+        
+        for (int i = 0; i < number_of_slots; ++i) {
+            slots[i].reference_count = 0;
+            slots[i].writer_owned = false;
+        }
+        
+        generation++;
+        
+        return number_of_slots;
+    }
+    
+    size_t SharedCVMatHeader::dataSegmentSize(const cv::Size& size, int mat_type, int requested_slots) {
+        
+        return alignedFrameBytes(size, mat_type) * std::min(requested_slots, SHMEM_MAX_MAT_SLOTS);
+    }
+    
+    std::string SharedCVMatHeader::dataSegmentName(const std::string& base_name, uint32_t generation) {
+        
+        return base_name + "_sh_data_" + std::to_string(generation);
     }
 
-    void SharedCVMatHeader::attachMatToHeader(boost::interprocess::managed_shared_memory& shared_mem, cv::Mat& mat) {
-        mat.create(mat_size, type);
-        mat.data = static_cast<uchar*> (shared_mem.get_address_from_handle(handle));
+    void SharedCVMatHeader::attachMatToSlot(void* data, int slot, cv::Mat& mat) {
+        
+        mat = cv::Mat(mat_size, type, static_cast<char*>(data) + slot * slot_bytes);
+    }
+    
+    int SharedCVMatHeader::acquireSlot() {
+        
+        for (int i = 0; i < number_of_slots; ++i) {
+            
+            if (i != latest_slot && 
+                !slots[i].writer_owned && 
+                slots[i].reference_count == 0) {
+                
+                slots[i].writer_owned = true;
+                return i;
+            }
+        }
+        
+        return -1;
+    }
+    
+    void SharedCVMatHeader::publishSlot(int slot, const Sample& sample) {
+        
+        slots[slot].writer_owned = false;
+        slots[slot].sample = sample;
+        latest_slot = slot;
+    }
+    
+    int SharedCVMatHeader::pinLatestSlot() {
+        
+        if (latest_slot >= 0) {
+            slots[latest_slot].reference_count++;
+        }
+        
+        return latest_slot;
+    }
+    
+    void SharedCVMatHeader::releaseSlot(int slot, uint32_t slot_generation) {
+        
+        // Pins on an old generation went away when the slots were rebuilt
+        if (slot_generation != generation) {
+            return;
+        }
+        
+        if (slot >= 0 && slots[slot].reference_count > 0) {
+            slots[slot].reference_count--;
+        }
     }
-}
\ No newline at end of file
+}
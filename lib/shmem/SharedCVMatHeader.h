@@ -17,12 +17,39 @@
 #ifndef SHAREDMAT_H
 #define	SHAREDMAT_H
 
+#include <cstdint>
+#include <string>
 #include <boost/interprocess/sync/interprocess_semaphore.hpp>
-#include <boost/interprocess/managed_shared_memory.hpp>
 #include <opencv2/core/mat.hpp>
 
+#include "ClientTable.h"
+#include "GenerationBroadcast.h"
+#include "Sample.h"
+
+#define SHMEM_MAX_MAT_SLOTS 16
+
 namespace shmem {
 
+    /**
+     * A preallocated frame buffer within the frame data segment. The
+     * server writes into slots that nobody is looking at and clients pin
+     * the slot they are reading until they release it.
+     */
+    struct SharedMatSlot {
+        
+        size_t reference_count; // Number of clients holding a view of this slot
+        bool writer_owned;      // Being written or waiting for publication
+        Sample sample;          // Identity of the frame held by this slot
+    };
+
+    /**
+     * Synchronization and geometry for a shared cv::Mat stream. The header 
+     * lives in a small managed segment of fixed size. Frame slots live in a 
+     * separate data segment that is sized exactly for the current frame 
+     * geometry. When the server changes resolution or ROI it creates a new
+     * data segment and bumps the generation; clients notice the change and
+     * remap before attaching to a slot.
+     */
     class SharedCVMatHeader {
         
     public:
@@ -30,12 +57,19 @@ namespace shmem {
         SharedCVMatHeader();
         
         boost::interprocess::interprocess_semaphore mutex;
+        
+        // Posted once by the last lossless client to read a frame
         boost::interprocess::interprocess_semaphore write_barrier;
-        boost::interprocess::interprocess_semaphore read_barrier;
-        boost::interprocess::interprocess_semaphore new_data_barrier;
         
-        size_t number_of_clients;
-        size_t client_read_count;
+        // Advanced each time a frame is published. Wakes all clients at once.
+        GenerationBroadcast published;
+        
+        // Client leases and the lossless read count of the latest frame
+        ClientTable clients;
+        
+        // Frames the server dropped before publication because no slot was
+        // free. Written by the server under the mutex.
+        uint64_t dropped_samples;
         
         // Used to get world coordinates from image
         bool world_coords_valid;
@@ -43,20 +77,60 @@ namespace shmem {
         float worldunits_per_px_x;
         float worldunits_per_px_y;
 
-        void buildHeader(boost::interprocess::managed_shared_memory& shared_mem, const cv::Mat& model);
-        void attachMatToHeader(boost::interprocess::managed_shared_memory& shared_mem, cv::Mat& mat);
+        /**
+         * Start a new generation of requested_slots frame slots of the given
+         * size and type. Any previous slots, and pins held on them, are 
+         * discarded. 
+         * The caller must hold the mutex and must have already created the
+         * data segment for the new generation.
+         * @return The number of slots in the new generation.
+         */
+        int buildHeader(const cv::Size& size, int mat_type, int requested_slots);
+        
+        /**
+         * Bytes needed by a data segment holding requested_slots frames of
+         * the given size and type.
+         */
+        static size_t dataSegmentSize(const cv::Size& size, int mat_type, int requested_slots);
+        
+        /**
+         * Name of the data segment holding the frames of a generation.
+         */
+        static std::string dataSegmentName(const std::string& base_name, uint32_t generation);
+        
+        /**
+         * Point mat at the data held by a slot. No pixel data is copied.
+         * @param data Start of the mapped data segment of the current generation
+         */
+        void attachMatToSlot(void* data, int slot, cv::Mat& mat);
+        
+        // Slot bookkeeping. The caller must hold the mutex.
+        int acquireSlot(void);          // Server: -1 if no slot is free
+        void publishSlot(int slot, const Sample& sample); // Server
+        int pinLatestSlot(void);        // Client: -1 if nothing published yet
+        void releaseSlot(int slot, uint32_t slot_generation); // Client
         
         // Accessors
-        void set_value(const cv::Mat& mat);    // Server
+        cv::Size get_mat_size(void) { return mat_size; }
+        int get_type(void) { return type; }
+        Sample get_slot_sample(int slot) { return slots[slot].sample; } // Caller must hold the mutex
+        uint32_t get_generation(void) { return generation; }
+        size_t get_slot_bytes(void) { return slot_bytes; }
+        size_t get_data_segment_size(void) { return slot_bytes * number_of_slots; }
         
     private:
         
         cv::Size mat_size;
         int type;
-        void* data_ptr;
-        int data_size_in_bytes;
         
-        boost::interprocess::managed_shared_memory::handle_t handle;
+        // Incremented each time the slots are rebuilt. Zero until the server
+        // has created the first data segment.
+        uint32_t generation;
+        size_t slot_bytes; // Frame size rounded up to a cache line
+        
+        int number_of_slots;
+        int latest_slot; // Most recently published slot
+        SharedMatSlot slots[SHMEM_MAX_MAT_SLOTS];
     };
 }
 
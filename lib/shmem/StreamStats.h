@@ -0,0 +1,327 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef STREAMSTATS_H
+#define	STREAMSTATS_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <signal.h>
+#include <unistd.h>
+#include <boost/interprocess/managed_shared_memory.hpp>
+
+#include "ClientTable.h"
+#include "Sample.h"
+
+// Well known segment shared by every server on the machine. The version is
+// part of the name so that tools never read a table with a different layout.
+#define SHMEM_STATS_SEGMENT_NAME "simple_tracker_stats_v3"
+#define SHMEM_STATS_OBJECT_NAME "stats_table"
+
+#define SHMEM_MAX_STATS_STREAMS 64
+#define SHMEM_STATS_NAME_LENGTH 32
+
+// How often servers copy the state of their clients into the stats
+#define SHMEM_STATS_CLIENT_PERIOD_MS 100
+
+namespace shmem {
+    
+    struct ClientStats {
+        
+        int32_t pid;
+        bool lossless;
+        uint32_t lag; // Publications not yet read by this client
+    };
+
+    /**
+     * Live counters of one server. Written by the server with relaxed atomics 
+     * and read by monitoring tools, which tolerate slightly stale or torn
+     * client lists.
+     */
+    struct StreamStats {
+        
+        // 0 free, 1 being claimed, 2 in use
+        std::atomic<uint32_t> state;
+        int32_t pid;
+        char name[SHMEM_STATS_NAME_LENGTH];
+        char kind[SHMEM_STATS_NAME_LENGTH]; // Payload type
+        
+        std::atomic<uint64_t> pushed;    // Samples handed to the server
+        std::atomic<uint64_t> published; // Samples made visible to clients
+        std::atomic<uint64_t> dropped;   // Samples lost to the overflow policy
+        std::atomic<uint32_t> buffer_occupancy;
+        std::atomic<uint32_t> buffer_depth;
+        
+        // Total time the server thread has spent waiting for lossless 
+        // clients to read
+        std::atomic<uint64_t> barrier_wait_ns;
+        
+        std::atomic<uint32_t> number_of_clients;
+        std::atomic<uint32_t> number_of_latest_only_clients;
+        std::atomic<uint32_t> number_of_client_stats;
+        ClientStats clients[SHMEM_MAX_CLIENTS];
+        
+        // Server side: snapshot the lag of each client behind publication.
+        // The caller must hold the mutex that guards table.
+        void recordClients(ClientTable& table, uint32_t publication) {
+            
+            uint32_t n = 0;
+            
+            for (int i = 0; i < SHMEM_MAX_CLIENTS; ++i) {
+                
+                ClientLease& lease = table.lease(i);
+                
+                if (lease.in_use) {
+                    clients[n].pid = lease.pid;
+                    clients[n].lossless = lease.qos == QoS::LOSSLESS;
+                    clients[n].lag = publication - lease.last_read;
+                    n++;
+                }
+            }
+            
+            number_of_client_stats.store(n, std::memory_order_relaxed);
+            number_of_clients.store(table.number_of_clients, std::memory_order_relaxed);
+            number_of_latest_only_clients.store(table.number_of_latest_only_clients, std::memory_order_relaxed);
+        }
+    };
+    
+    /**
+     * Name of a processing stage. Held by the process of the server that 
+     * registered it until the server is destroyed or the process exits.
+     */
+    struct StageName {
+        
+        // 0 free, 1 being claimed, 2 in use
+        std::atomic<uint32_t> state;
+        int32_t pid;
+        char name[SHMEM_STATS_NAME_LENGTH];
+    };
+    
+    struct StatsTable {
+        StreamStats streams[SHMEM_MAX_STATS_STREAMS];
+        StageName stages[SHMEM_MAX_STAGES];
+    };
+
+    /**
+     * Access to the well known stats segment. Servers claim an entry for the
+     * lifetime of the server; monitors read all of them. 
+     */
+    class StatsSegment {
+    public:
+        
+        StatsSegment(void) : 
+          table(nullptr)
+        , unclaimed() { }
+        
+        /**
+         * Create the segment if needed and claim an entry. Servers keep
+         * serving if this fails, so failures are reported but not fatal.
+         * @return The claimed entry, or a private dummy entry on failure.
+         */
+        StreamStats* claim(const std::string& name, const std::string& kind) {
+            
+            if (!open(name)) {
+                return &unclaimed;
+            }
+            
+            for (int i = 0; i < SHMEM_MAX_STATS_STREAMS; ++i) {
+                
+                StreamStats& stats = table->streams[i];
+                uint32_t expected = 0;
+                
+                // Entries left behind by servers that crashed can be reused
+                if (stats.state == 2 && !isAlive(stats.pid)) {
+                    expected = 2;
+                }
+                
+                if (stats.state.compare_exchange_strong(expected, 1)) {
+                    
+                    stats.pid = getpid();
+                    std::strncpy(stats.name, name.c_str(), SHMEM_STATS_NAME_LENGTH - 1);
+                    stats.name[SHMEM_STATS_NAME_LENGTH - 1] = '\0';
+                    std::strncpy(stats.kind, kind.c_str(), SHMEM_STATS_NAME_LENGTH - 1);
+                    stats.kind[SHMEM_STATS_NAME_LENGTH - 1] = '\0';
+                    
+                    stats.pushed = 0;
+                    stats.published = 0;
+                    stats.dropped = 0;
+                    stats.buffer_occupancy = 0;
+                    stats.buffer_depth = 0;
+                    stats.barrier_wait_ns = 0;
+                    stats.number_of_clients = 0;
+                    stats.number_of_latest_only_clients = 0;
+                    stats.number_of_client_stats = 0;
+                    
+                    stats.state = 2;
+                    return &stats;
+                }
+            }
+            
+            std::cerr << "Stats for \'" + name + "\' are unavailable: all " + 
+                         std::to_string(SHMEM_MAX_STATS_STREAMS) + " entries are in use.\n";
+            return &unclaimed;
+        }
+        
+        /**
+         * Find or add the index of a stage name, which samples carry in place
+         * of the name. Every process gets the same index for the same name 
+         * while the stage is registered. Call releaseStage when done.
+         * @return SHMEM_UNKNOWN_STAGE if the segment is unavailable or full.
+         */
+        uint32_t registerStage(const std::string& name) {
+            
+            if (!open(name)) {
+                return SHMEM_UNKNOWN_STAGE;
+            }
+            
+            // Server names are unique, so an entry with this name can only 
+            // have been left by a server that crashed
+            for (uint32_t i = 0; i < SHMEM_MAX_STAGES; ++i) {
+                
+                StageName& stage = table->stages[i];
+                
+                if (stage.state == 2 && 
+                    std::strncmp(stage.name, name.c_str(), SHMEM_STATS_NAME_LENGTH - 1) == 0) {
+                    stage.pid = getpid();
+                    return i;
+                }
+            }
+            
+            for (uint32_t i = 0; i < SHMEM_MAX_STAGES; ++i) {
+                
+                StageName& stage = table->stages[i];
+                uint32_t expected = 0;
+                
+                // Entries left behind by servers that crashed can be reused
+                if (stage.state == 2 && !isAlive(stage.pid)) {
+                    expected = 2;
+                }
+                
+                if (stage.state.compare_exchange_strong(expected, 1)) {
+                    stage.pid = getpid();
+                    std::strncpy(stage.name, name.c_str(), SHMEM_STATS_NAME_LENGTH - 1);
+                    stage.name[SHMEM_STATS_NAME_LENGTH - 1] = '\0';
+                    stage.state = 2;
+                    return i;
+                }
+            }
+            
+            std::cerr << "Stage \'" + name + "\' is unnamed in latency profiles: all " + 
+                         std::to_string(SHMEM_MAX_STAGES) + " stage names are in use.\n";
+            return SHMEM_UNKNOWN_STAGE;
+        }
+        
+        // Free a stage name registered by this process
+        void releaseStage(uint32_t stage) {
+            
+            if (table != nullptr && stage < SHMEM_MAX_STAGES && 
+                table->stages[stage].state == 2 && table->stages[stage].pid == getpid()) {
+                table->stages[stage].state = 0;
+            }
+        }
+        
+        /**
+         * Monitor side: the name of a registered stage.
+         * @return "?" if it is unknown.
+         */
+        std::string stageName(uint32_t stage) {
+            
+            if (table == nullptr && !attach()) {
+                return "?";
+            }
+            
+            if (stage >= SHMEM_MAX_STAGES || table->stages[stage].state != 2) {
+                return "?";
+            }
+            
+            return std::string(table->stages[stage].name);
+        }
+        
+        void release(StreamStats* stats) {
+            
+            if (stats != &unclaimed) {
+                stats->state = 0;
+            }
+        }
+        
+        /**
+         * Monitor side: attach to the segment if any server has created it.
+         * @return False if no server has published stats yet.
+         */
+        bool attach(void) {
+            
+            try {
+                
+                segment = boost::interprocess::managed_shared_memory(
+                        boost::interprocess::open_only,
+                        SHMEM_STATS_SEGMENT_NAME);
+                
+                table = segment.find<StatsTable>(SHMEM_STATS_OBJECT_NAME).first;
+                
+            } catch (boost::interprocess::interprocess_exception& ex) {
+                return false;
+            }
+            
+            return table != nullptr;
+        }
+        
+        StatsTable* get_table(void) { return table; }
+        
+        static bool isAlive(int32_t pid) {
+            return kill(pid, 0) == 0 || errno != ESRCH;
+        }
+        
+    private:
+        
+        // Create the segment if needed. Failures are reported on behalf of
+        // the named stream.
+        bool open(const std::string& name) {
+            
+            if (table != nullptr) {
+                return true;
+            }
+            
+            try {
+                
+                segment = boost::interprocess::managed_shared_memory(
+                        boost::interprocess::open_or_create,
+                        SHMEM_STATS_SEGMENT_NAME,
+                        sizeof(StatsTable) + 1024);
+                
+                table = segment.find_or_construct<StatsTable>(SHMEM_STATS_OBJECT_NAME)();
+                
+            } catch (boost::interprocess::interprocess_exception& ex) {
+                std::cerr << "Stats for \'" + name + "\' are unavailable: " << ex.what() << '\n';
+                return false;
+            }
+            
+            return true;
+        }
+        
+        boost::interprocess::managed_shared_memory segment;
+        StatsTable* table;
+        
+        // Stands in for a claimed entry when the segment is unavailable
+        StreamStats unclaimed;
+    };
+}
+
+#endif	/* STREAMSTATS_H */
@@ -17,31 +17,73 @@
 #ifndef SYNCSHAREDMEMORYOBJECT_H
 #define	SYNCSHAREDMEMORYOBJECT_H
 
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
 #include <boost/interprocess/sync/interprocess_semaphore.hpp>
+#include <boost/thread/thread_time.hpp>
 
+#include "../log/Log.h"
+#include "ClientTable.h"
+#include "GenerationBroadcast.h"
 #include "Position.h"
+#include "QoS.h"
+#include "StreamStats.h"
 
 namespace shmem {
 
+    /**
+     * Shared object that forces the server and all of its lossless clients to
+     * proceed in lockstep: the server waits for every lossless client to read 
+     * a value before publishing the next one. Latest-only clients are woken on
+     * each write but are never waited on.
+     */
     template <class T>
     class SyncSharedMemoryObject {
     public:
+        
+        // Name of the object within a stream's segment
+        static std::string objectName(const std::string& stream_name) {
+            return stream_name + "_sh_obj";
+        }
 
         SyncSharedMemoryObject(void) :
           mutex(1)
         , write_barrier(0)
-        , read_barrier(0)
-        , new_data_barrier(0)
-        , number_of_clients(0)
-        , client_read_count(0) { }
+        , client_lease_ns(SHMEM_DEFAULT_CLIENT_LEASE_MS * 1000000LL)
+        , dropped_samples(0) { }
 
         boost::interprocess::interprocess_semaphore mutex;
+        
+        // Posted once by the last lossless client to read a value
         boost::interprocess::interprocess_semaphore write_barrier;
-        boost::interprocess::interprocess_semaphore read_barrier;
-        boost::interprocess::interprocess_semaphore new_data_barrier;
         
-        size_t number_of_clients;
-        size_t client_read_count;
+        // Advanced each time a value is published. Wakes all clients at once.
+        GenerationBroadcast published;
+        
+        // Client leases and the lossless read count of the latest value
+        ClientTable clients;
+        
+        // Clients that go this long without reading or waiting to read are
+        // evicted. Set by the server.
+        int64_t client_lease_ns;
+        
+        // Samples the server dropped before publication because its buffer
+        // was full. Informational, so it is not synchronized.
+        uint64_t dropped_samples;
+        
+        void set_dropped_samples(uint64_t value) { dropped_samples = value; }
+        uint64_t get_dropped_samples(void) { return dropped_samples; }
+        void set_client_lease(int64_t value_ns) { client_lease_ns = value_ns; }
+        
+        // Per-client read progress, kept by the client process
+        struct ReadState {
+            QoS qos = QoS::LOSSLESS;
+            uint32_t last_published = 0; // Generation of the last value read
+            int client_index = -1;       // Lease in the client table
+            uint64_t client_ticket = 0;
+        };
 
         void set_value(T value) {
             object = value;
@@ -50,9 +92,166 @@ namespace shmem {
         T get_value(void) {
             return object;
         }
+        
+        /**
+         * Register a new client.
+         * @param qos Whether the server should wait for this client.
+         * @param state The client's read state, which records its QoS and lease.
+         * @return The number of clients, including this one.
+         */
+        int addClient(QoS qos, ReadState& state) {
+            
+            state.qos = qos;
+            
+            mutex.wait();
+            joinClientTable(state);
+            int client_num = clients.number_of_clients + clients.number_of_latest_only_clients;
+            mutex.post();
+            
+            return client_num;
+        }
+        
+        void removeClient(const ReadState& state) {
+            
+            // If the server is waiting on the latest value, this client no 
+            // longer needs to read it. A client that was evicted is already
+            // gone.
+            mutex.wait();
+            if (clients.owns(state.client_index, state.client_ticket) &&
+                clients.remove(state.client_index, published.get())) {
+                write_barrier.post();
+            }
+            mutex.post();
+        }
+        
+        /**
+         * Server side: write value and block until all lossless clients have
+         * read it. Clients that die without detaching are evicted, so this 
+         * returns within a bounded time even if one of them crashes.
+         * @return Nanoseconds spent waiting for clients to read value.
+         */
+        int64_t publish(const T& value) {
+            
+            /* START CRITICAL SECTION */
+            mutex.wait();
+
+            // Perform write in shared memory 
+            set_value(value);
+            
+            clients.evictDeadClients(client_lease_ns, published.get(), ignoreEviction);
+            bool wait_for_clients = clients.startPublication();
+            
+            // Together with the write, so that no client reads the new value
+            // under the old generation
+            published.advance();
+
+            mutex.post();
+            /* END CRITICAL SECTION */
+            
+            // Wake all clients with a single broadcast
+            published.wake();
+
+            if (!wait_for_clients) {
+                return 0;
+            }
+            
+            int64_t wait_start_ns = Sample::nowInNs();
+            while (!write_barrier.timed_wait(boost::get_system_time() +
+                    boost::posix_time::milliseconds(SHMEM_LIVENESS_CHECK_MS))) {
+                
+                /* START CRITICAL SECTION */
+                mutex.wait();
+                bool released = clients.evictDeadClients(client_lease_ns, published.get(), ignoreEviction);
+                mutex.post();
+                /* END CRITICAL SECTION */
+                
+                if (released) {
+                    break;
+                }
+            }
+            
+            return Sample::nowInNs() - wait_start_ns;
+        }
+        
+        /**
+         * Client side: read the next value published by the server. Lossless
+         * clients read every value; latest-only clients read the newest value
+         * written since their last read.
+         * @return False if no new value was published within the timeout, in
+         * which case the read can simply be repeated.
+         */
+        bool consume(T& value, ReadState& state) {
+            
+            // Renew the lease while waiting so that an idle stream does not
+            // get this client evicted
+            bool changed = false;
+            for (int i = 0; i < 100 / SHMEM_LIVENESS_CHECK_MS && !changed; ++i) {
+                clients.heartbeat(state.client_index);
+                changed = published.waitForChange(state.last_published, 
+                        std::chrono::milliseconds(SHMEM_LIVENESS_CHECK_MS));
+            }
+            
+            if (!changed) {
+                return false;
+            }
+
+            /* START CRITICAL SECTION */
+            mutex.wait();
+            
+            // Evicted after its lease ran out, e.g. while stopped in a debugger
+            if (!clients.owns(state.client_index, state.client_ticket)) {
+                STLOG_WARNING("A client was evicted by its server and has rejoined.\n");
+                joinClientTable(state);
+            }
+
+            value = get_value();
+            state.last_published = published.get();
+
+            // The last lossless client to read releases the server
+            if (clients.countRead(state.client_index, state.last_published)) {
+                write_barrier.post();
+            }
+
+            mutex.post();
+            /* END CRITICAL SECTION */
+
+            return true;
+        }
+        
+        /**
+         * Unblock a server that is waiting on its clients.
+         */
+        void releaseServer(void) {
+            write_barrier.post();
+        }
+        
+        /**
+         * Server side: copy the state of each client into stats.
+         */
+        void recordClientStats(StreamStats& stats) {
+            
+            mutex.wait();
+            stats.recordClients(clients, published.get());
+            mutex.post();
+        }
 
     private:
         T object;
+        
+        // Must be called with the mutex held
+        void joinClientTable(ReadState& state) {
+            
+            state.client_index = clients.add(state.qos, published.get(), state.client_ticket);
+            
+            if (state.client_index < 0) {
+                mutex.post();
+                std::cerr << "A server already has the maximum of " + std::to_string(SHMEM_MAX_CLIENTS) + " clients.\n";
+                exit(EXIT_FAILURE);
+            }
+        }
+        
+        // Values hold no resources on behalf of clients
+        static void ignoreEviction(ClientLease&) { }
 
     };
 }
@@ -62,4 +261,3 @@ template class shmem::SyncSharedMemoryObject<shmem::Position>;
 
 
 #endif	/* SYNCSHAREDMEMORYOBJECT_H */
-
@@ -0,0 +1,107 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef TRANSPORT_H
+#define	TRANSPORT_H
+
+#include <iostream>
+#include <string>
+
+#include "../cpptoml/cpptoml.h"
+#include "ObjectClient.h"
+#include "ObjectServer.h"
+#include "SMClient.h"
+#include "SMServer.h"
+#include "SeqLockSharedMemoryObject.h"
+#include "SyncSharedMemoryObject.h"
+
+namespace shmem {
+
+    /**
+     * Shared object that carries an object stream. The server and all clients
+     * of a stream must use the same transport.
+     */
+    enum class Transport {
+        
+        // Lossless clients are read in lockstep with the server
+        SYNC,
+        
+        // Latest value only, behind a sequence lock. Neither side ever waits
+        // on the other, so only use this where skipping values is acceptable.
+        SEQLOCK
+    };
+    
+    /**
+     * Parse the transport configuration value: "sync" or "seqlock".
+     * @return False if value is not a known transport, in which case 
+     * transport is not changed.
+     */
+    inline bool parseTransport(const std::string& value, Transport& transport) {
+        
+        if (value == "sync") {
+            transport = Transport::SYNC;
+        } else if (value == "seqlock") {
+            transport = Transport::SEQLOCK;
+        } else {
+            return false;
+        }
+        
+        return true;
+    }
+    
+    /**
+     * Read an optional transport key from a configuration table. An unknown 
+     * value is reported and ignored.
+     * @return True if transport was set from the table.
+     */
+    inline bool parseTransport(const cpptoml::table& config, Transport& transport) {
+        
+        if (!config.contains("transport")) {
+            return false;
+        }
+        
+        std::string value = *config.get_as<std::string>("transport");
+        
+        if (!parseTransport(value, transport)) {
+            std::cerr << "Unknown transport \"" + value + "\". Keeping the default." << std::endl;
+            return false;
+        }
+        
+        return true;
+    }
+    
+    template<class T>
+    ObjectServer<T>* makeServer(Transport transport, std::string sink_name) {
+        
+        if (transport == Transport::SEQLOCK) {
+            return new SMServer<T, SeqLockSharedMemoryObject>(sink_name);
+        }
+        
+        return new SMServer<T, SyncSharedMemoryObject>(sink_name);
+    }
+    
+    template<class T>
+    ObjectClient<T>* makeClient(Transport transport, std::string source_name) {
+        
+        if (transport == Transport::SEQLOCK) {
+            return new SMClient<T, SeqLockSharedMemoryObject>(source_name);
+        }
+        
+        return new SMClient<T, SyncSharedMemoryObject>(source_name);
+    }
+}
+
+#endif	/* TRANSPORT_H */
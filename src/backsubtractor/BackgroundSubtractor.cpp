@@ -20,6 +20,7 @@
 #include <iostream>
 
 #include <opencv2/core/mat.hpp>
+#include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
 #include "../../lib/shmem/MatClient.h"
@@ -50,16 +51,22 @@ void BackgroundSubtractor::setBackgroundImage() {
  */
 void BackgroundSubtractor::subtractBackground() {
     
-    // Only proceed with processing if we are getting a valid frame
-    if (frame_source.getSharedMat(current_frame)) {
-
-        current_raw_frame = current_frame.clone();
+    // Only proceed with processing if we are getting a valid frame. The raw
+    // frame is a read-only view of shared memory.
+    if (frame_source.getSharedMat(current_raw_frame)) {
         
+        int64_t enter_ns = shmem::Sample::nowInNs();
+
+        // Write the result straight into the output's shared memory
+        if (!frame_sink.acquireMat(current_frame, current_raw_frame.size(), current_raw_frame.type())) {
+            return;
+        }
+
         if (background_set) {
 
             try {
-                CV_Assert(current_frame.size() == background_img.size());
-                current_frame = current_frame - background_img;
+                CV_Assert(current_raw_frame.size() == background_img.size());
+                cv::subtract(current_raw_frame, background_img, current_frame);
             } catch (cv::Exception& e) {
                 std::cout << "CV Exception: " << e.what() << "\n";
                 exit(EXIT_FAILURE);
@@ -69,9 +76,12 @@ void BackgroundSubtractor::subtractBackground() {
 
             // First image is always used as the default background image
             setBackgroundImage();
+            current_raw_frame.copyTo(current_frame);
         }
 
-        frame_sink.pushMat(current_frame);
+        shmem::Sample sample = frame_source.get_sample();
+        sample.addStage(frame_sink.get_stage(), enter_ns);
+        frame_sink.commitMat(sample);
     }
 
 }
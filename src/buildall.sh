@@ -5,3 +5,4 @@ make -C ./detector/build
 make -C ./posicom/build
 make -C ./decorator/build
 make -C ./posifilt/build
+make -C ./sttop/build
@@ -68,6 +68,11 @@ protected:
     
     // Currently acquired frame
     cv::Mat current_frame;
+    
+    // Identity of the current frame. grabMat implementations must call 
+    // current_sample.stampNext() as close to acquisition as possible, and
+    // serveMat must add the camera's stage stamp just before pushing.
+    shmem::Sample current_sample;
 
     // Camera matrix and distortion coefficients. Use to undistort image
     bool undistort_image;
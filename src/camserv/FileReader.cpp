@@ -24,9 +24,12 @@
 FileReader::FileReader(std::string file_name_in, std::string image_sink_name) :
 Camera(image_sink_name)
 , file_name(file_name_in)
+, frame_rate_in_hz(24)
+, pacing(Pacing::REALTIME)
+, media_epoch_ns(0)
+, read_time_ns(0)
 , file_reader(file_name_in)
-, use_roi(false)
-, frame_rate_in_hz(24) {
+, use_roi(false) {
 
     // Default config
     configure();
@@ -34,6 +37,21 @@ Camera(image_sink_name)
 
 void FileReader::grabMat() {
     file_reader >> current_frame;
+    read_time_ns = shmem::Sample::nowInNs();
+    
+    if (pacing == Pacing::VIRTUAL_CLOCK) {
+        
+        if (current_sample.number == 0) {
+            media_epoch_ns = read_time_ns;
+        }
+        
+        // Downstream stages see the frame spacing of the recording, however
+        // fast the file is actually being read
+        current_sample.stampNext(media_epoch_ns + mediaTimeInNs());
+        
+    } else {
+        current_sample.stampNext();
+    }
     
     // Crop if nessesary
     if (use_roi) {
@@ -44,8 +62,15 @@ void FileReader::grabMat() {
 void FileReader::serveMat() {
     
     if (!current_frame.empty()) {
-        frame_sink.pushMat(current_frame);
-        usleep(frame_period_in_us);
+        // The stage is timed from the read, which is not the capture time 
+        // under a virtual clock
+        current_sample.addStage(frame_sink.get_stage(), read_time_ns);
+        frame_sink.pushMat(current_frame, current_sample);
+        
+        // Unpaced readers are held back only by a blocking overflow policy
+        if (pacing == Pacing::REALTIME) {
+            usleep(frame_period_in_us);
+        }
     } else {
         frame_sink.set_running(false); //TODO: signal close somehow
     }
@@ -76,6 +101,31 @@ void FileReader::configure(std::string file_name, std::string key) {
                 calculateFramePeriod();
             }
             
+            if (this_config.contains("pacing")) {
+                std::string value = *this_config.get_as<std::string>("pacing");
+                if (!parsePacing(value)) {
+                    std::cerr << "Unknown pacing \"" + value + "\". Keeping the default." << std::endl;
+                }
+            }
+            
+            // Without back-pressure an unpaced reader would outrun its 
+            // clients and drop most of the file
+            if (pacing != Pacing::REALTIME) {
+                frame_sink.set_overflow_policy(shmem::OverflowPolicy::BLOCK);
+            }
+            
+            if (this_config.contains("frame_buffer_slots")) {
+                frame_sink.set_number_of_slots((int) (*this_config.get_as<int64_t>("frame_buffer_slots")));
+            }
+            
+            shmem::OverflowPolicy policy;
+            if (shmem::parseOverflowPolicy(this_config, policy)) {
+                if (pacing != Pacing::REALTIME && policy != shmem::OverflowPolicy::BLOCK) {
+                    std::cerr << "Warning: unpaced file reading with a dropping overflow_policy will drop frames." << std::endl;
+                }
+                frame_sink.set_overflow_policy(policy);
+            }
+            
             if (this_config.contains("roi")) {
 
                 auto roi = *this_config.get_table("roi");
@@ -104,3 +154,31 @@ void FileReader::configure(std::string file_name, std::string key) {
 void FileReader::calculateFramePeriod() {
     frame_period_in_us = 1.0e6 * (1.0 / frame_rate_in_hz);
 }
+
+bool FileReader::parsePacing(const std::string& value) {
+
+    if (value == "realtime") {
+        pacing = Pacing::REALTIME;
+    } else if (value == "unpaced") {
+        pacing = Pacing::UNPACED;
+    } else if (value == "virtual_clock") {
+        pacing = Pacing::VIRTUAL_CLOCK;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+int64_t FileReader::mediaTimeInNs() {
+    
+    // Position of the frame just read. Containers without timestamps report
+    // zero, so fall back to the nominal frame rate.
+    double media_time_ms = file_reader.get(cv::CAP_PROP_POS_MSEC);
+    
+    if (media_time_ms <= 0 && current_sample.number > 0) {
+        return static_cast<int64_t>(current_sample.number * 1.0e9 / frame_rate_in_hz);
+    }
+    
+    return static_cast<int64_t>(media_time_ms * 1.0e6);
+}
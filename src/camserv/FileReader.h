@@ -24,6 +24,14 @@
 
 class FileReader : public Camera {
 public:
+    
+    // How frames are released from the file
+    enum class Pacing {
+        REALTIME,     // At the configured frame rate, stamped as they are read
+        UNPACED,      // As fast as clients take them, stamped as they are read
+        VIRTUAL_CLOCK // As fast as clients take them, stamped with media time
+    };
+    
     FileReader(std::string file_name_in, std::string image_sink_name);
     
     // Implement Camera interface
@@ -39,6 +47,15 @@ private:
     double frame_rate_in_hz;
     void calculateFramePeriod(void);
     
+    Pacing pacing;
+    bool parsePacing(const std::string& value);
+    
+    // steady_clock time that media time zero is mapped to in VIRTUAL_CLOCK 
+    // mode, and the wall time the current frame was read
+    int64_t media_epoch_ns;
+    int64_t read_time_ns;
+    int64_t mediaTimeInNs(void);
+    
     // File read
     cv::VideoCapture file_reader;
     
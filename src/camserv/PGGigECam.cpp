@@ -29,6 +29,7 @@
 
 #include "../../lib/cpptoml/cpptoml.h"
 #include "../../lib/shmem/SharedCVMatHeader.h"
+#include "../../lib/log/Log.h"
 #include "../../lib/shmem/MatServer.h"
 
 #include "stdafx.h"
@@ -149,6 +150,16 @@ void PGGigECam::configure(std::string config_file, std::string key) {
                 setupWhiteBalance(false);
             }
 
+            // Number of frames preallocated in shared memory
+            if (camera_config.contains("frame_buffer_slots")) {
+                frame_sink.set_number_of_slots((int) (*camera_config.get_as<int64_t>("frame_buffer_slots")));
+            }
+
+            shmem::OverflowPolicy policy;
+            if (shmem::parseOverflowPolicy(camera_config, policy)) {
+                frame_sink.set_overflow_policy(policy);
+            }
+
             // Set the ROI
             if (camera_config.contains("roi")) {
 
@@ -701,13 +712,12 @@ void PGGigECam::grabImage() {
 
     Error error = camera.RetrieveBuffer(&raw_image);
     if (error == PGRERROR_IMAGE_CONSISTENCY_ERROR) {
-        std::cout << "WARNING: torn image detected.\n";
+        STLOG_WARNING("Torn image detected.\n");
 
         // TODO: implement onboard buffer and perform retry a RetrieveBuffer
         // A single time if a torn image is detected.
     } else if (error != PGRERROR_OK) {
-        printError(error);
-        std::cout << "WARNING: capture error.\n";
+        STLOG_WARNING("Capture error: " + std::string(error.GetDescription()) + "\n");
     }
 }
 
@@ -725,6 +735,7 @@ cv::Mat PGGigECam::imageToMat() {
 void PGGigECam::grabMat() {
 
     grabImage();
+    current_sample.stampNext();
     current_frame = imageToMat();
 }
 
@@ -732,7 +743,8 @@ void PGGigECam::serveMat() {
 
     // Write frame to shared memory and notify all client processes
     // that a new frame is available. Do not block, though.
-    frame_sink.pushMat(current_frame);
+    current_sample.addStage(frame_sink.get_stage(), current_sample.capture_time_ns);
+    frame_sink.pushMat(current_frame, current_sample);
 }
 
 // PRIVATE
@@ -25,10 +25,12 @@ WebCam::WebCam(std::string frame_sink_name) :
 
 void WebCam::grabMat() {
     cv_camera >> current_frame;
+    current_sample.stampNext();
 }
 
 void WebCam::serveMat() {
-    frame_sink.pushMat(current_frame);
+    current_sample.addStage(frame_sink.get_stage(), current_sample.capture_time_ns);
+    frame_sink.pushMat(current_frame, current_sample);
 }
 
 void WebCam::configure() {
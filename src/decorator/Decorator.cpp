@@ -38,7 +38,7 @@ void Decorator::decorateAndServeImage() {
     switch (current_processing_stage) {
         case 0:
 
-            if (!frame_source.getSharedMat(image)) {
+            if (!frame_source.getSharedMat(frame)) {
                 return;
             }
 
@@ -52,14 +52,48 @@ void Decorator::decorateAndServeImage() {
             }
 
             // Fall through
+            current_processing_stage = 2;
+
+        case 2:
+
+            // Join on sample number. If one source is behind, read it again
+            // until the frame and position line up. Sources that do not 
+            // stamp their samples leave the number at 0 and can never line
+            // up, so those are just paired.
+            while (frame_source.get_sample().number != 0 && position.sample.number != 0 &&
+                   frame_source.get_sample().number != position.sample.number) {
+
+                if (frame_source.get_sample().number < position.sample.number) {
+                    if (!frame_source.getSharedMat(frame)) {
+                        return;
+                    }
+                } else {
+                    if (!position_source.getSharedObject(position)) {
+                        return;
+                    }
+                }
+            }
+
             current_processing_stage = 0;
     }
 
-    // Decorated image
+    // Frame and position are in hand
+    int64_t enter_ns = shmem::Sample::nowInNs();
+
+    // The shared frame is read-only, so draw on a copy. The copy goes 
+    // straight into the output's shared memory.
+    if (!frame_sink.acquireMat(image, frame.size(), frame.type())) {
+        return;
+    }
+    
+    frame.copyTo(image);
     drawSymbols();
     
-    // Serve the finished product
-    frame_sink.pushMat(image);
+    // Serve the finished product. The position has passed through more 
+    // stages than the frame, so its stamps are the ones carried on.
+    shmem::Sample sample = position.sample;
+    sample.addStage(frame_sink.get_stage(), enter_ns);
+    frame_sink.commitMat(sample);
     
 }
 
@@ -37,7 +37,7 @@ public:
 private:
     
     // Image data
-    cv::Mat image;
+    cv::Mat frame, image;
     
     // For multi-server processing, we need to keep track of all the servers
     // we have finished reading from each processing step
@@ -0,0 +1,118 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "BandPool.h"
+
+#include <utility>
+
+BandPool::BandPool(int threads) :
+  job(nullptr)
+, number_of_bands(0)
+, next_band(0)
+, busy(0)
+, generation(0)
+, stopping(false) {
+    
+    for (int i = 1; i < threads; ++i) {
+        workers.push_back(std::thread(&BandPool::work, this));
+    }
+}
+
+BandPool::~BandPool() {
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    
+    job_posted.notify_all();
+    
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void BandPool::run(int bands, const std::function<void(int)>& band_job) {
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &band_job;
+        number_of_bands = bands;
+        next_band = 0;
+        busy = static_cast<int>(workers.size());
+        ++generation;
+    }
+    
+    job_posted.notify_all();
+    claimBands();
+    
+    std::exception_ptr job_error;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        job_done.wait(lock, [this] { return busy == 0; });
+        job = nullptr;
+        std::swap(job_error, error);
+    }
+    
+    if (job_error) {
+        std::rethrow_exception(job_error);
+    }
+}
+
+void BandPool::work() {
+    
+    uint64_t last_generation = 0;
+    
+    while (true) {
+        
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_posted.wait(lock, [&] { return stopping || generation != last_generation; });
+            
+            if (stopping) {
+                return;
+            }
+            
+            last_generation = generation;
+        }
+        
+        claimBands();
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0) {
+            job_done.notify_one();
+        }
+    }
+}
+
+void BandPool::claimBands() {
+    
+    try {
+        int band;
+        while ((band = next_band++) < number_of_bands) {
+            (*job)(band);
+        }
+    } catch (...) {
+        
+        // No one claims the remaining bands
+        next_band = number_of_bands;
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+}
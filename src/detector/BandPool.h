@@ -0,0 +1,71 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef BANDPOOL_H
+#define	BANDPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Persistent threads that share out the bands of one job, e.g. the 
+ * horizontal stripes of a frame, and wait for all of them to finish. The 
+ * calling thread works too, so a pool of N threads starts N - 1 workers.
+ */
+class BandPool {
+public:
+    
+    BandPool(int threads);
+    ~BandPool();
+    
+    int get_threads(void) const { return static_cast<int>(workers.size()) + 1; }
+    
+    // Call job(band) once for every band in [0, bands) and return when all
+    // calls have returned. If a call throws, bands not yet started are 
+    // skipped and the first exception is rethrown here. Not reentrant.
+    void run(int bands, const std::function<void(int)>& job);
+    
+private:
+    
+    std::vector<std::thread> workers;
+    
+    std::mutex mutex;
+    std::condition_variable job_posted, job_done;
+    
+    // The current job. Bands are claimed through next_band.
+    const std::function<void(int)>* job;
+    int number_of_bands;
+    std::atomic<int> next_band;
+    
+    // First exception thrown by the current job
+    std::exception_ptr error;
+    
+    // Workers still on the current job
+    int busy;
+    uint64_t generation;
+    bool stopping;
+    
+    void work(void);
+    void claimBands(void);
+};
+
+#endif	/* BANDPOOL_H */
@@ -0,0 +1,271 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "BlobFinder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <opencv2/core.hpp>
+
+namespace {
+    
+    // Index of the first non-zero byte in row[x, width), or width. Masks are
+    // mostly zero, so whole words of zeros are skipped at once.
+    inline int nextNonZero(const uchar* row, int x, int width) {
+        
+        while (x + 8 <= width) {
+            uint64_t word;
+            std::memcpy(&word, row + x, sizeof (word));
+            if (word != 0) {
+                break;
+            }
+            x += 8;
+        }
+        
+        while (x < width && row[x] == 0) {
+            ++x;
+        }
+        
+        return x;
+    }
+    
+    inline int nextZero(const uchar* row, int x, int width) {
+        
+        while (x < width && row[x] != 0) {
+            ++x;
+        }
+        
+        return x;
+    }
+}
+
+BlobFinder::BlobFinder() :
+  scan_begin(0)
+, scan_end(0) { }
+
+const std::vector<Blob>& BlobFinder::find(const cv::Mat& mask) {
+    
+    return find(mask, 0, mask.rows);
+}
+
+const std::vector<Blob>& BlobFinder::find(const cv::Mat& mask, int y_begin, int y_end) {
+    
+    CV_Assert(mask.type() == CV_8UC1);
+    CV_Assert(y_begin >= 0 && y_begin <= y_end && y_end <= mask.rows);
+    
+    runs.clear();
+    parent.clear();
+    blobs.clear();
+    scan_begin = y_begin;
+    scan_end = y_end;
+    
+    size_t above_begin = 0, above_end = 0;
+    
+    for (int y = y_begin; y < y_end; ++y) {
+        
+        const uchar* row = mask.ptr<uchar>(y);
+        size_t row_begin = runs.size();
+        size_t above = above_begin;
+        int x = 0;
+        
+        while ((x = nextNonZero(row, x, mask.cols)) < mask.cols) {
+            
+            Run run;
+            run.y = y;
+            run.x_start = x;
+            x = nextZero(row, x, mask.cols);
+            run.x_end = x - 1;
+            run.label = -1;
+            
+            // Runs on the row above that touch this one, diagonals included. 
+            // The last of them may also touch the next run on this row, so 
+            // the search resumes from it.
+            while (above < above_end && runs[above].x_end < run.x_start - 1) {
+                ++above;
+            }
+            
+            for (size_t a = above; a < above_end && runs[a].x_start <= run.x_end + 1; ++a) {
+                run.label = run.label < 0 ? root(runs[a].label) : unite(run.label, runs[a].label);
+            }
+            
+            if (run.label < 0) {
+                run.label = static_cast<int>(parent.size());
+                parent.push_back(run.label);
+            }
+            
+            runs.push_back(run);
+        }
+        
+        above_begin = row_begin;
+        above_end = runs.size();
+    }
+    
+    // Sum each run into the blob of its final label
+    blob_of_label.assign(parent.size(), -1);
+    
+    for (Run& run : runs) {
+        
+        int label = root(run.label);
+        
+        if (blob_of_label[label] < 0) {
+            blob_of_label[label] = static_cast<int>(blobs.size());
+            Blob blob = {0, 0, 0, run.x_start, run.y, run.x_end, run.y};
+            blobs.push_back(blob);
+        }
+        
+        run.label = blob_of_label[label];
+        Blob& blob = blobs[run.label];
+        int64_t length = run.x_end - run.x_start + 1;
+        
+        blob.area += length;
+        blob.sum_x += length * (run.x_start + run.x_end) / 2;
+        blob.sum_y += length * run.y;
+        blob.x_min = std::min(blob.x_min, run.x_start);
+        blob.x_max = std::max(blob.x_max, run.x_end);
+        blob.y_max = run.y;
+    }
+    
+    return blobs;
+}
+
+const std::vector<Blob>& BlobFinder::merge(const std::vector<BlobFinder>& band_finders) {
+    
+    runs.clear();
+    parent.clear();
+    blobs.clear();
+    
+    // Each band's blobs are given consecutive labels
+    first_label.clear();
+    
+    for (const BlobFinder& band : band_finders) {
+        first_label.push_back(static_cast<int>(parent.size()));
+        for (size_t i = 0; i < band.blobs.size(); ++i) {
+            parent.push_back(static_cast<int>(parent.size()));
+        }
+    }
+    
+    // Join blobs with runs touching across each boundary, as find would have.
+    // Bands without rows do not separate their neighbours.
+    size_t u = 0;
+    
+    for (size_t b = 1; b < band_finders.size(); ++b) {
+        
+        const BlobFinder& upper = band_finders[u];
+        const BlobFinder& lower = band_finders[b];
+        
+        if (lower.scan_end == lower.scan_begin) {
+            continue;
+        }
+        
+        size_t upper_band = u;
+        u = b;
+        
+        if (upper.scan_end != lower.scan_begin || upper.scan_end == upper.scan_begin) {
+            continue;
+        }
+        
+        // Runs on the last row of the upper band and the first of the lower
+        size_t above_end = upper.runs.size();
+        size_t above = above_end;
+        while (above > 0 && upper.runs[above - 1].y == upper.scan_end - 1) {
+            --above;
+        }
+        
+        for (size_t r = 0; r < lower.runs.size() && lower.runs[r].y == lower.scan_begin; ++r) {
+            
+            const Run& run = lower.runs[r];
+            
+            while (above < above_end && upper.runs[above].x_end < run.x_start - 1) {
+                ++above;
+            }
+            
+            for (size_t a = above; a < above_end && upper.runs[a].x_start <= run.x_end + 1; ++a) {
+                unite(first_label[upper_band] + upper.runs[a].label, first_label[b] + run.label);
+            }
+        }
+    }
+    
+    // Sum the band blobs into their joined blob. Bands are visited from the 
+    // top, so blobs come out in the order find gives them.
+    blob_of_label.assign(parent.size(), -1);
+    
+    for (size_t b = 0; b < band_finders.size(); ++b) {
+        
+        const std::vector<Blob>& band_blobs = band_finders[b].blobs;
+        
+        for (size_t i = 0; i < band_blobs.size(); ++i) {
+            
+            int label = root(first_label[b] + static_cast<int>(i));
+            const Blob& part = band_blobs[i];
+            
+            if (blob_of_label[label] < 0) {
+                blob_of_label[label] = static_cast<int>(blobs.size());
+                blobs.push_back(part);
+                continue;
+            }
+            
+            Blob& blob = blobs[blob_of_label[label]];
+            blob.area += part.area;
+            blob.sum_x += part.sum_x;
+            blob.sum_y += part.sum_y;
+            blob.x_min = std::min(blob.x_min, part.x_min);
+            blob.y_min = std::min(blob.y_min, part.y_min);
+            blob.x_max = std::max(blob.x_max, part.x_max);
+            blob.y_max = std::max(blob.y_max, part.y_max);
+        }
+    }
+    
+    return blobs;
+}
+
+const Blob* BlobFinder::largest(double min_area, double max_area) const {
+    
+    const Blob* best = nullptr;
+    
+    for (const Blob& blob : blobs) {
+        if (blob.area > min_area && blob.area < max_area && 
+            (best == nullptr || blob.area > best->area)) {
+            best = &blob;
+        }
+    }
+    
+    return best;
+}
+
+int BlobFinder::root(int label) {
+    
+    while (parent[label] != label) {
+        parent[label] = parent[parent[label]];
+        label = parent[label];
+    }
+    
+    return label;
+}
+
+int BlobFinder::unite(int a, int b) {
+    
+    a = root(a);
+    b = root(b);
+    
+    // The older label survives, which keeps trees shallow for raster order
+    if (a < b) {
+        parent[b] = a;
+        return a;
+    }
+    
+    parent[a] = b;
+    return b;
+}
@@ -0,0 +1,94 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef BLOBFINDER_H
+#define	BLOBFINDER_H
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+
+/**
+ * A connected group of non-zero mask pixels
+ */
+struct Blob {
+    
+    int64_t area;         // Pixels
+    int64_t sum_x, sum_y; // Of pixel coordinates, for the centroid
+    int x_min, y_min, x_max, y_max;
+    
+    cv::Point2f centroid(void) const {
+        return cv::Point2f(static_cast<float>(static_cast<double>(sum_x) / area), 
+                           static_cast<float>(static_cast<double>(sum_y) / area));
+    }
+    
+    cv::Rect boundingBox(void) const {
+        return cv::Rect(x_min, y_min, x_max - x_min + 1, y_max - y_min + 1);
+    }
+};
+
+/**
+ * Finds the 8-connected components of a binary mask and their area, centroid
+ * and bounding box in a single read-only scan. Each row is split into runs of
+ * non-zero pixels, runs touching a run on the row above are joined with 
+ * union-find, and statistics are then summed per run rather than per pixel.
+ * Buffers are reused between calls.
+ */
+class BlobFinder {
+public:
+    
+    BlobFinder(void);
+    
+    // Components of a CV_8UC1 mask, valid until the next call
+    const std::vector<Blob>& find(const cv::Mat& mask);
+    
+    // Components of rows [y_begin, y_end) of mask alone, in mask coordinates
+    const std::vector<Blob>& find(const cv::Mat& mask, int y_begin, int y_end);
+    
+    /**
+     * Join the components that band_finders found in consecutive bands of the
+     * same mask, top band first, joining those that touch across a band 
+     * boundary. The result is the same as that of find over the whole mask.
+     */
+    const std::vector<Blob>& merge(const std::vector<BlobFinder>& band_finders);
+    
+    /**
+     * Largest blob found by the last call to find whose area is strictly 
+     * between min_area and max_area, or null if there is none.
+     */
+    const Blob* largest(double min_area, double max_area) const;
+    
+private:
+    
+    struct Run {
+        int y, x_start, x_end; // x_end inclusive
+        int label;             // Index of the run's blob once find returns
+    };
+    
+    // Rows scanned by the last call to find
+    int scan_begin, scan_end;
+    
+    std::vector<Run> runs;
+    std::vector<int> parent;
+    std::vector<int> blob_of_label;
+    std::vector<int> first_label; // Of each band's blobs, when merging
+    std::vector<Blob> blobs;
+    
+    int root(int label);
+    int unite(int a, int b);
+};
+
+#endif	/* BLOBFINDER_H */
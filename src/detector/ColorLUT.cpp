@@ -0,0 +1,267 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "ColorLUT.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COLORLUT_X86 1
+#include <immintrin.h>
+#else
+#define COLORLUT_X86 0
+#endif
+
+// Bytes a 32-bit read of the last entry runs past the end of the table
+#define COLORLUT_TABLE_PADDING 3
+
+ColorLUT::ColorLUT(int bits_per_channel) :
+  bits(0)
+, built_count(0) {
+    
+    set_bits(bits_per_channel);
+}
+
+void ColorLUT::set_bits(int bits_per_channel) {
+    
+    int value = std::min(std::max(bits_per_channel, COLORLUT_MIN_BITS), COLORLUT_MAX_BITS);
+    
+    if (value == bits) {
+        return;
+    }
+    
+    bits = value;
+    
+    int shift = 8 - bits;
+    int bins = 1 << bits;
+    int half_bin = shift > 0 ? 1 << (shift - 1) : 0;
+    int entries = 1 << (3 * bits);
+    
+    table.assign(entries + COLORLUT_TABLE_PADDING, 0);
+    
+    bin_centres.create(1, entries, CV_8UC3);
+    uchar* centre = bin_centres.ptr<uchar>(0);
+    
+    for (int b = 0; b < bins; ++b) {
+        for (int g = 0; g < bins; ++g) {
+            for (int r = 0; r < bins; ++r, centre += 3) {
+                centre[0] = (b << shift) + half_bin;
+                centre[1] = (g << shift) + half_bin;
+                centre[2] = (r << shift) + half_bin;
+            }
+        }
+    }
+    
+    // Nothing has been built at this resolution yet
+    built_count = 0;
+}
+
+bool ColorLUT::update(const HSVThreshold* thresholds, int count) {
+    
+    CV_Assert(count > 0 && count <= HSVTHRESHOLD_MAX_CLASSES);
+    
+    if (count == built_count && std::equal(thresholds, thresholds + count, built_from)) {
+        return false;
+    }
+    
+    HSVThreshold::apply(bin_centres, thresholds, bin_masks, count);
+    
+    int entries = 1 << (3 * bits);
+    std::fill(table.begin(), table.end(), 0);
+    
+    for (int i = 0; i < count; ++i) {
+        
+        const uchar* mask = bin_masks[i].ptr<uchar>(0);
+        uchar bit = static_cast<uchar>(1 << i);
+        
+        for (int e = 0; e < entries; ++e) {
+            table[e] |= mask[e] & bit;
+        }
+    }
+    
+    std::copy(thresholds, thresholds + count, built_from);
+    built_count = count;
+    
+    return true;
+}
+
+void ColorLUT::apply(const cv::Mat& bgr, cv::Mat* masks) const {
+    
+    apply(bgr, masks, HSVThreshold::bestKernel());
+}
+
+void ColorLUT::apply(const cv::Mat& bgr, cv::Mat* masks, HSVThreshold::Kernel kernel) const {
+    
+    CV_Assert(bgr.type() == CV_8UC3);
+    CV_Assert(built_count > 0);
+    
+    if (!HSVThreshold::isSupported(kernel)) {
+        kernel = HSVThreshold::Kernel::SCALAR;
+    }
+    
+    int rows = bgr.rows;
+    int cols = bgr.cols;
+    bool continuous = bgr.isContinuous();
+    
+    for (int i = 0; i < built_count; ++i) {
+        masks[i].create(bgr.size(), CV_8UC1);
+        continuous = continuous && masks[i].isContinuous();
+    }
+    
+    if (continuous) {
+        cols *= rows;
+        rows = 1;
+    }
+    
+    uchar* out[HSVTHRESHOLD_MAX_CLASSES];
+    
+    for (int y = 0; y < rows; ++y) {
+        
+        const uchar* in = bgr.ptr<uchar>(y);
+        for (int i = 0; i < built_count; ++i) {
+            out[i] = masks[i].ptr<uchar>(y);
+        }
+        
+        switch (kernel) {
+            case HSVThreshold::Kernel::AVX2:
+                labelRowAVX2(in, out, cols);
+                break;
+            case HSVThreshold::Kernel::SSE41:
+                labelRowSSE41(in, out, cols);
+                break;
+            default:
+                labelRowScalar(in, out, 0, cols);
+                break;
+        }
+    }
+}
+
+void ColorLUT::labelRowScalar(const uchar* bgr, uchar* const* masks, int begin, int width) const {
+    
+    const uchar* t = table.data();
+    int shift = 8 - bits;
+    
+    for (int x = begin; x < width; ++x) {
+        
+        const uchar* p = bgr + 3 * x;
+        int index = ((p[0] >> shift) << (2 * bits)) | ((p[1] >> shift) << bits) | (p[2] >> shift);
+        uchar label = t[index];
+        
+        for (int i = 0; i < built_count; ++i) {
+            masks[i][x] = static_cast<uchar>(-((label >> i) & 1));
+        }
+    }
+}
+
+#if COLORLUT_X86
+
+namespace {
+    
+    // Expand bit i of 16 labels into a 0xff/0x00 mask for each set of bounds
+    __attribute__((target("sse4.1")))
+    inline void splitLabels(__m128i labels, uchar* const* masks, int x, int count) {
+        
+        for (int i = 0; i < count; ++i) {
+            __m128i bit = _mm_set1_epi8(static_cast<char>(1 << i));
+            __m128i mask = _mm_cmpeq_epi8(_mm_and_si128(labels, bit), bit);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(masks[i] + x), mask);
+        }
+    }
+    
+    /**
+     * Labels of the eight BGR pixels at bgr, one per 32-bit lane. Reads one
+     * byte past the eighth pixel.
+     */
+    __attribute__((target("avx2")))
+    inline __m256i gatherLabelsAVX2(const uchar* bgr, const uchar* table, __m128i shift, __m128i bits, __m128i bits2) {
+        
+        const __m256i offsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+        const __m256i low_byte = _mm256_set1_epi32(0xff);
+        
+        __m256i pixels = _mm256_i32gather_epi32(reinterpret_cast<const int*>(bgr), offsets, 1);
+        
+        __m256i b = _mm256_srl_epi32(_mm256_and_si256(pixels, low_byte), shift);
+        __m256i g = _mm256_srl_epi32(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), low_byte), shift);
+        __m256i r = _mm256_srl_epi32(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), low_byte), shift);
+        
+        __m256i index = _mm256_or_si256(_mm256_or_si256(_mm256_sll_epi32(b, bits2), _mm256_sll_epi32(g, bits)), r);
+        
+        return _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(table), index, 1), low_byte);
+    }
+}
+
+__attribute__((target("sse4.1")))
+void ColorLUT::labelRowSSE41(const uchar* bgr, uchar* const* masks, int width) const {
+    
+    const uchar* t = table.data();
+    int shift = 8 - bits;
+    
+    alignas(16) uchar labels[16];
+    
+    // There is no gather before AVX2, so only the split is vectorised
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        
+        const uchar* p = bgr + 3 * x;
+        for (int k = 0; k < 16; ++k, p += 3) {
+            labels[k] = t[((p[0] >> shift) << (2 * bits)) | ((p[1] >> shift) << bits) | (p[2] >> shift)];
+        }
+        
+        splitLabels(_mm_load_si128(reinterpret_cast<const __m128i*>(labels)), masks, x, built_count);
+    }
+    
+    labelRowScalar(bgr, masks, x, width);
+}
+
+__attribute__((target("avx2")))
+void ColorLUT::labelRowAVX2(const uchar* bgr, uchar* const* masks, int width) const {
+    
+    const uchar* t = table.data();
+    const __m128i shift = _mm_cvtsi32_si128(8 - bits);
+    const __m128i bits1 = _mm_cvtsi32_si128(bits);
+    const __m128i bits2 = _mm_cvtsi32_si128(2 * bits);
+    
+    // Strictly less, as the gathers read one byte past the 16th pixel
+    int x = 0;
+    for (; x + 16 < width; x += 16) {
+        
+        const uchar* p = bgr + 3 * x;
+        __m256i lo = gatherLabelsAVX2(p, t, shift, bits1, bits2);
+        __m256i hi = gatherLabelsAVX2(p + 24, t, shift, bits1, bits2);
+        
+        __m128i lo16 = _mm_packus_epi32(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1));
+        __m128i hi16 = _mm_packus_epi32(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1));
+        
+        splitLabels(_mm_packus_epi16(lo16, hi16), masks, x, built_count);
+    }
+    
+    labelRowScalar(bgr, masks, x, width);
+}
+
+#else
+
+// Never selected on other architectures
+void ColorLUT::labelRowSSE41(const uchar* bgr, uchar* const* masks, int width) const {
+    labelRowScalar(bgr, masks, 0, width);
+}
+
+void ColorLUT::labelRowAVX2(const uchar* bgr, uchar* const* masks, int width) const {
+    labelRowScalar(bgr, masks, 0, width);
+}
+
+#endif
@@ -0,0 +1,92 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef COLORLUT_H
+#define	COLORLUT_H
+
+#include <vector>
+#include <opencv2/core/mat.hpp>
+
+#include "HSVThreshold.h"
+
+#define COLORLUT_DEFAULT_BITS 6
+#define COLORLUT_MIN_BITS 4
+#define COLORLUT_MAX_BITS 8
+
+/**
+ * HSV classifier that looks each BGR pixel up in a precomputed table instead
+ * of converting it. Each channel is quantized to bits_per_channel bits and 
+ * every bin holds a byte whose bit i says whether the bin's central colour 
+ * passes the i'th set of HSVThreshold bounds.
+ * 
+ * The table is only rebuilt when the bounds change, by running the bin 
+ * centres through HSVThreshold. With 6 bits that is 2^18 pixels, around a 
+ * millisecond, so it can follow the tuning sliders live. Near the edges of 
+ * a pass band a pixel may be classified as its bin centre rather than 
+ * itself; with 8 bits the result is exact.
+ * 
+ * Memory grows eightfold with each bit. With 6 bits and one set of bounds
+ * it is about 1.3 MB. With 8 bits it is 48 MB of bin centres, 16 MB of 
+ * table and 16 MB of masks for each set of bounds. Every frame worker has 
+ * its own.
+ */
+class ColorLUT {
+public:
+    
+    ColorLUT(int bits_per_channel = COLORLUT_DEFAULT_BITS);
+    
+    // Clamped to [COLORLUT_MIN_BITS, COLORLUT_MAX_BITS]
+    void set_bits(int bits_per_channel);
+    int get_bits(void) const { return bits; }
+    
+    /**
+     * Rebuild the table for the given bounds unless it was already built 
+     * from exactly these.
+     * @return True if the table was rebuilt.
+     */
+    bool update(const HSVThreshold* thresholds, int count);
+    
+    /**
+     * Write one CV_8UC1 mask per set of bounds given to update, 255 where 
+     * the BGR pixel passes and 0 elsewhere.
+     */
+    void apply(const cv::Mat& bgr, cv::Mat* masks) const;
+    
+    // Use a particular kernel, or the scalar one if the CPU lacks it
+    void apply(const cv::Mat& bgr, cv::Mat* masks, HSVThreshold::Kernel kernel) const;
+    
+private:
+    
+    int bits;
+    
+    // Bit i of an entry is set if the bin passes thresholds[i]. Padded so 
+    // that four bytes can be read from any entry.
+    std::vector<uchar> table;
+    
+    // The bounds the table was built from
+    HSVThreshold built_from[HSVTHRESHOLD_MAX_CLASSES];
+    int built_count;
+    
+    // Central colour of every bin, in table order, and their masks
+    cv::Mat bin_centres;
+    cv::Mat bin_masks[HSVTHRESHOLD_MAX_CLASSES];
+    
+    void labelRowScalar(const uchar* bgr, uchar* const* masks, int begin, int width) const;
+    void labelRowSSE41(const uchar* bgr, uchar* const* masks, int width) const;
+    void labelRowAVX2(const uchar* bgr, uchar* const* masks, int width) const;
+};
+
+#endif	/* COLORLUT_H */
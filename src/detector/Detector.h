@@ -17,33 +17,58 @@
 #ifndef DETECTOR_H
 #define	DETECTOR_H
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 #include <opencv2/opencv.hpp>
 #include <boost/thread/mutex.hpp>
 
+#include "../../lib/cpptoml/cpptoml.h"
 #include "../../lib/shmem/Position.h"
 #include "../../lib/shmem/MatClient.h"
 #include "../../lib/shmem/SMServer.h"
+#include "../../lib/shmem/Transport.h"
+#include "BandPool.h"
+#include "BlobFinder.h"
 
 /**
  * Abstract base class to be implemented by any object detector within the 
  * Simple Tracker project
  * @param image_source_name Image SOURCE name
  * @param position_sink_name Position SINK name
+ * @param serve_position False for detectors that serve positions to SINKs 
+ * of their own, in which case there is no position_sink
  */
 class Detector {
 public:
     
-    Detector(std::string image_source_name, std::string position_sink_name) : 
-      image_source(image_source_name)
-    , position_sink(position_sink_name)
+    Detector(std::string image_source_name, std::string position_sink_name, bool serve_position = true) : 
+      min_object_area(0)
+    , max_object_area(std::numeric_limits<double>::max())
+    , tuning_on(false)
+    , tuning_windows_created(false)
     , tuning_image_title(position_sink_name + "_tuning")
     , slider_title(position_sink_name + "_sliders")
-    , tuning_windows_created(false)
-    , tuning_on(false) { 
+    , image_source(image_source_name)
+    , position_sink(serve_position ? new shmem::SMServer<shmem::Position>(position_sink_name) : nullptr)
+    , threads(1)
+    , tracking_on(false)
+    , tracking_miss_limit(5)
+    , tracking_margin_px(16)
+    , track_valid(false)
+    , track_misses(0)
+    , track_radius(0) { 
       
           image_source.findSharedMat();
       } 
+    
+    // Detectors are deleted through this class
+    virtual ~Detector() { }
       
     // Detector must be able to find an object
     virtual void findObjectAndServePosition(void) = 0;
@@ -55,10 +80,259 @@ public:
     bool get_tune_mode(void) { tuning_mutex.lock(); return tuning_on; tuning_mutex.unlock();}
     
     // Detectors must be interruptable
-    void stop(void) { position_sink.set_running(false); }
+    virtual void stop(void) { if (position_sink) { position_sink->set_running(false); } }
+    
+    // Only blobs with an area strictly between these, in pixels, are objects
+    void set_min_object_area(double value) { min_object_area = value; }
+    void set_max_object_area(double value) { max_object_area = value; }
+    
+    /**
+     * Search each frame only within a window around the object's predicted
+     * position. The window is sized from the object's size and recent 
+     * velocity and grows with each frame the object is missed. After more 
+     * than miss_limit misses in a row the whole frame is searched again.
+     * Tuning always searches the whole frame.
+     */
+    void set_tracking(bool value, int miss_limit, int margin_px) {
+        tracking_on = value;
+        tracking_miss_limit = std::max(miss_limit, 0);
+        tracking_margin_px = std::max(margin_px, 0);
+        track_valid = false;
+    }
+    
+    /**
+     * Split each frame into this many horizontal bands and process them on as
+     * many threads. Components that span bands are joined, so the result is 
+     * the same as with a single thread.
+     */
+    void set_threads(int value) {
+        threads = std::max(value, 1);
+        band_pool.reset(threads > 1 ? new BandPool(threads) : nullptr);
+        band_finders.resize(threads);
+    }
+    
+    int get_threads(void) const { return threads; }
     
 protected:
     
+    // Blobs of the current threshold image
+    BlobFinder blob_finder;
+    double min_object_area;
+    double max_object_area;
+    
+    // Read an optional object_area = {min = PX, max = PX} table
+    void configureObjectArea(cpptoml::table& config) {
+        
+        if (config.contains("object_area")) {
+            
+            auto t = *config.get_table("object_area");
+            
+            if (t.contains("min")) {
+                min_object_area = (double) (*t.get_as<int64_t>("min"));
+            }
+            if (t.contains("max")) {
+                max_object_area = (double) (*t.get_as<int64_t>("max"));
+            }
+        }
+    }
+    
+    /**
+     * Call job(band, band_rows) for each band of an image with the given
+     * number of rows and return once all calls have. Bands may have no rows
+     * when the image has fewer rows than there are threads.
+     */
+    void forEachBand(int rows, const std::function<void(int, const cv::Range&)>& job) {
+        
+        if (!band_pool) {
+            job(0, cv::Range(0, rows));
+            return;
+        }
+        
+        int bands = threads;
+        band_pool->run(bands, [&](int band) {
+            job(band, cv::Range(rows * band / bands, rows * (band + 1) / bands));
+        });
+    }
+    
+    // Find the blobs of mask with finder, band by band when threaded
+    void findBlobs(const cv::Mat& mask, BlobFinder& finder) {
+        
+        if (!band_pool) {
+            finder.find(mask);
+            return;
+        }
+        
+        forEachBand(mask.rows, [&](int band, const cv::Range& rows) {
+            band_finders[band].find(mask, rows.start, rows.end);
+        });
+        
+        finder.merge(band_finders);
+    }
+    
+    void findBlobs(const cv::Mat& mask) { findBlobs(mask, blob_finder); }
+    
+    /**
+     * Erode and then dilate mask, if each is on. OpenCV filters read the rows
+     * around a band from the parent image, so bands give the same result as 
+     * the whole image, but they cannot then be filtered in place. When 
+     * threaded each step writes to scratch, which is then swapped with mask.
+     */
+    void clarify(cv::Mat& mask, cv::Mat& scratch, 
+                 bool erode_on, const cv::Mat& erode_element, 
+                 bool dilate_on, const cv::Mat& dilate_element) {
+        
+        if (!band_pool) {
+            
+            if (erode_on) {
+                cv::erode(mask, mask, erode_element);
+            }
+            if (dilate_on) {
+                cv::dilate(mask, mask, dilate_element);
+            }
+            return;
+        }
+        
+        for (int step = 0; step < 2; ++step) {
+            
+            bool erode = step == 0;
+            if (!(erode ? erode_on : dilate_on)) {
+                continue;
+            }
+            
+            scratch.create(mask.size(), mask.type());
+            
+            forEachBand(mask.rows, [&](int, const cv::Range& rows) {
+                
+                if (rows.empty()) {
+                    return;
+                }
+                
+                cv::Mat out = scratch.rowRange(rows);
+                if (erode) {
+                    cv::erode(mask.rowRange(rows), out, erode_element);
+                } else {
+                    cv::dilate(mask.rowRange(rows), out, dilate_element);
+                }
+            });
+            
+            std::swap(mask, scratch);
+        }
+    }
+    
+    /**
+     * Read an optional transport key and replace position_sink with a server
+     * of that transport. Call before configuring the sink, since the new 
+     * server starts from the defaults.
+     */
+    void configureTransport(cpptoml::table& config) {
+        
+        shmem::Transport transport;
+        if (position_sink && shmem::parseTransport(config, transport)) {
+            std::string sink_name = position_sink->get_name();
+            position_sink.reset();
+            position_sink.reset(shmem::makeServer<shmem::Position>(transport, sink_name));
+        }
+    }
+    
+    // Read an optional threads = N key
+    void configureThreads(cpptoml::table& config) {
+        
+        if (config.contains("threads")) {
+            set_threads((int) (*config.get_as<int64_t>("threads")));
+        }
+    }
+    
+    // Region of the current frame to search. Empty means the whole frame.
+    cv::Rect search_window;
+    
+    // The part of frame to search
+    cv::Mat searchView(const cv::Mat& frame) {
+        return search_window.area() > 0 ? frame(search_window) : frame;
+    }
+    
+    // Choose search_window for the next frame
+    void startSearch(const cv::Size& frame_size) {
+        
+        search_window = cv::Rect();
+        
+        if (!tracking_on || tuning_on || !track_valid) {
+            return;
+        }
+        
+        // Constant velocity prediction, with the uncertainty growing by one
+        // frame of motion for every frame elapsed since the last detection
+        float steps = 1 + track_misses;
+        cv::Point2f predicted = track_position + steps * track_velocity;
+        float speed = std::sqrt(track_velocity.x * track_velocity.x + track_velocity.y * track_velocity.y);
+        int half_width = static_cast<int>(std::ceil(track_radius + tracking_margin_px + steps * speed));
+        
+        cv::Rect window(static_cast<int>(predicted.x) - half_width, 
+                        static_cast<int>(predicted.y) - half_width,
+                        2 * half_width + 1, 2 * half_width + 1);
+        
+        search_window = window & cv::Rect(0, 0, frame_size.width, frame_size.height);
+        
+        // Clipped away entirely, or no smaller than the frame anyway
+        if (search_window.area() == 0 || search_window.size() == frame_size) {
+            search_window = cv::Rect();
+        }
+    }
+    
+    /**
+     * Report the outcome of searching search_window.
+     * @param found Whether the object was found.
+     * @param position Object position in frame coordinates.
+     * @param radius_px Approximate object radius.
+     */
+    void endSearch(bool found, const shmem::Position3D& position, double radius_px) {
+        
+        if (!tracking_on) {
+            return;
+        }
+        
+        if (found) {
+            
+            cv::Point2f measured(position.x, position.y);
+            
+            if (track_valid) {
+                // Smoothed so one bad detection cannot throw the window off
+                cv::Point2f step = (1.0f / (1 + track_misses)) * (measured - track_position);
+                track_velocity = 0.5f * (track_velocity + step);
+            } else {
+                track_velocity = cv::Point2f(0, 0);
+            }
+            
+            track_position = measured;
+            track_radius = radius_px;
+            track_misses = 0;
+            track_valid = true;
+            
+        } else if (track_valid && ++track_misses > tracking_miss_limit) {
+            track_valid = false;
+            track_misses = 0;
+        }
+    }
+    
+    // Read an optional tracking = {miss_limit = N, margin = PX} table
+    void configureTracking(cpptoml::table& config) {
+        
+        if (config.contains("tracking")) {
+            
+            auto t = *config.get_table("tracking");
+            int miss_limit = tracking_miss_limit;
+            int margin_px = tracking_margin_px;
+            
+            if (t.contains("miss_limit")) {
+                miss_limit = (int) (*t.get_as<int64_t>("miss_limit"));
+            }
+            if (t.contains("margin")) {
+                margin_px = (int) (*t.get_as<int64_t>("margin"));
+            }
+            
+            set_tracking(true, miss_limit, margin_px);
+        }
+    }
+    
     // Detector must implement method  sifting a threshold image to find objects
     virtual void siftBlobs(void) = 0;
     
@@ -82,7 +356,23 @@ protected:
     MatClient image_source;
     
     // The detected object position destination (Server side)
-    shmem::SMServer<shmem::Position> position_sink;
+    std::unique_ptr<shmem::ObjectServer<shmem::Position> > position_sink;
+    
+private:
+    
+    // Band parallel processing. No pool means a single thread.
+    int threads;
+    std::unique_ptr<BandPool> band_pool;
+    std::vector<BlobFinder> band_finders;
+    
+    // Search window tracking
+    bool tracking_on;
+    int tracking_miss_limit;
+    int tracking_margin_px;
+    bool track_valid;
+    int track_misses;
+    cv::Point2f track_position, track_velocity;
+    double track_radius;
     
 };
 
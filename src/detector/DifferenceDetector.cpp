@@ -24,7 +24,11 @@
 
 DifferenceDetector::DifferenceDetector(std::string image_source_name, std::string position_sink_name) :
 Detector(image_source_name, position_sink_name)
-, last_image_set(false) {
+, current_grey(0)
+, last_image_set(false)
+, object_area(0)
+, object_radius(0)
+, difference_intensity_threshold(20) {
 
     set_blur_size(2);
 }
@@ -33,12 +37,18 @@ void DifferenceDetector::findObjectAndServePosition() {
 
     // If we are able to get a an image
     if (image_source.getSharedMat(this_image)) {
+
+        int64_t enter_ns = shmem::Sample::nowInNs();
+        object_position.sample = image_source.get_sample();
         addWorldReferenceFrame();
+        startSearch(this_image.size());
         applyThreshold();
         siftBlobs();
+        endSearch(object_position.position_valid, object_position.position, object_radius);
         tune();
 
-        position_sink.pushObject(object_position);
+        object_position.sample.addStage(position_sink->get_stage(), enter_ns);
+        position_sink->pushObject(object_position);
     }
 }
 
@@ -58,6 +68,8 @@ void DifferenceDetector::configure(std::string file_name, std::string key) {
 
             auto this_config = *config.get_table(key);
 
+            configureTransport(this_config);
+
             if (this_config.contains("blur")) {
                 set_blur_size((int) (*this_config.get_as<int64_t>("blur")));
             }
@@ -66,6 +78,10 @@ void DifferenceDetector::configure(std::string file_name, std::string key) {
                 difference_intensity_threshold = (int) (*this_config.get_as<int64_t>("diff_threshold"));
             }
 
+            configureObjectArea(this_config);
+            configureTracking(this_config);
+            configureThreads(this_config);
+            
             if (this_config.contains("tune")) {
                 if (*this_config.get_as<bool>("tune")) {
                     tuning_on = true;
@@ -84,33 +100,21 @@ void DifferenceDetector::configure(std::string file_name, std::string key) {
 
 void DifferenceDetector::siftBlobs() {
 
-    cv::Mat thresh_cpy = threshold_image.clone();
-    std::vector< std::vector < cv::Point > > contours;
-    std::vector< cv::Vec4i > hierarchy;
-
-    //these two vectors needed for output of findContours
-    //find contours of filtered image using openCV findContours function
-    //findContours(temp,contours,hierarchy,CV_RETR_CCOMP,CV_CHAIN_APPROX_SIMPLE );// retrieves all contours
-    cv::findContours(thresh_cpy, contours, hierarchy, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE); // retrieves external contours
-
-    //if contours vector is not empty, we have found some objects
-    if (contours.size() > 0) {
-        object_position.position_valid = true;
-    } else
-        object_position.position_valid = false;
+    // We will simply assume that the biggest moving blob is the object we are
+    // looking for
+    findBlobs(threshold_image);
+    const Blob* object = blob_finder.largest(min_object_area, max_object_area);
+    object_position.position_valid = object != nullptr;
 
     if (object_position.position_valid) {
 
-        //the largest contour is found at the end of the contours vector
-        //we will simply assume that the biggest contour is the object we are looking for.
-        std::vector< std::vector<cv::Point> > largestContourVec;
-        largestContourVec.push_back(contours.at(contours.size() - 1));
-
-        //make a bounding rectangle around the largest contour then find its centroid
+        //make a bounding rectangle around the largest blob then find its centroid
         //this will be the object's final estimated position.
-        cv::Rect objectBoundingRectangle = cv::boundingRect(largestContourVec.at(0));
-        object_position.position.x = objectBoundingRectangle.x + 0.5 * objectBoundingRectangle.width;
-        object_position.position.y = objectBoundingRectangle.y + 0.5 * objectBoundingRectangle.height;
+        cv::Rect objectBoundingRectangle = object->boundingBox();
+        object_area = static_cast<double>(object->area);
+        object_position.position.x = search_window.x + objectBoundingRectangle.x + 0.5 * objectBoundingRectangle.width;
+        object_position.position.y = search_window.y + objectBoundingRectangle.y + 0.5 * objectBoundingRectangle.height;
+        object_radius = 0.5 * std::max(objectBoundingRectangle.width, objectBoundingRectangle.height);
 
         if (tuning_on) {
             
@@ -161,22 +165,49 @@ void DifferenceDetector::addWorldReferenceFrame() {
 
 void DifferenceDetector::applyThreshold() {
 
-    if (last_image_set) {
-        cv::cvtColor(this_image, this_image, cv::COLOR_BGR2GRAY);
-        cv::absdiff(this_image, last_image, threshold_image);
-        cv::threshold(threshold_image, threshold_image, difference_intensity_threshold, 255, cv::THRESH_BINARY);
-        if (blur_on) {
-            cv::blur(threshold_image, threshold_image, blur_size);
+    cv::Rect window = search_window.area() > 0 ? search_window : cv::Rect(0, 0, this_image.cols, this_image.rows);
+    
+    // The whole frame is converted so that any window of the next one has 
+    // something to be compared with. This overwrites the frame before last.
+    current_grey ^= 1;
+    cv::Mat& this_grey = grey[current_grey];
+    this_grey.create(this_image.size(), CV_8UC1);
+    
+    forEachBand(this_image.rows, [&](int, const cv::Range& rows) {
+        
+        if (!rows.empty()) {
+            cv::Mat out = this_grey.rowRange(rows);
+            cv::cvtColor(this_image.rowRange(rows), out, cv::COLOR_BGR2GRAY);
+        }
+    });
+    
+    motion_mask.create(this_image.size(), CV_8UC1);
+    threshold_image = motion_mask(window);
+    
+    const cv::Mat& last_grey = grey[current_grey ^ 1];
+    
+    if (last_image_set && last_grey.size() == this_image.size()) {
+        
+        // The tuning sliders write to these directly. Each band has its own
+        // scratch buffers.
+        band_differences.resize(get_threads());
+        for (FrameDifference& difference : band_differences) {
+            difference.set_threshold(difference_intensity_threshold);
+            difference.set_box_size(blur_on ? blur_size.width : 1);
         }
-        cv::threshold(threshold_image, threshold_image, difference_intensity_threshold, 255, cv::THRESH_BINARY);
-        last_image = this_image.clone(); // Get a copy of the last image
+        
+        cv::Mat current = this_grey(window);
+        cv::Mat previous = last_grey(window);
+        
+        forEachBand(window.height, [&](int band, const cv::Range& rows) {
+            band_differences[band].apply(current, previous, threshold_image, rows.start, rows.end);
+        });
     } else {
-        threshold_image = this_image.clone();
-        cv::cvtColor(threshold_image, threshold_image, cv::COLOR_BGR2GRAY);
-        last_image = this_image.clone();
-        cv::cvtColor(last_image, last_image, cv::COLOR_BGR2GRAY);
-        last_image_set = true;
+        // Nothing has moved yet
+        threshold_image.setTo(0);
     }
+    
+    last_image_set = true;
 }
 
 void DifferenceDetector::tune() {
@@ -9,6 +9,7 @@
 #define	DIFFERENCEDETECTOR_H
 
 #include "Detector.h"
+#include "FrameDifference.h"
 
 class DifferenceDetector : public Detector {
 public:
@@ -23,12 +24,22 @@ public:
 private:
     
     // Intermediate variables
-    cv::Mat this_image, last_image;
-    cv::Mat threshold_image;
+    cv::Mat this_image;
+    
+    // The search window of motion_mask, which is allocated once
+    cv::Mat threshold_image, motion_mask;
+    
+    // Grey frames, alternately current and previous
+    cv::Mat grey[2];
+    int current_grey;
     bool last_image_set;
     
+    // One per band
+    std::vector<FrameDifference> band_differences;
+    
     // Object detection
     double object_area;
+    double object_radius;
     shmem::Position object_position;
     
     // Detector parameters
@@ -0,0 +1,233 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "FrameDifference.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <opencv2/opencv.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    
+    // Index of the pixel that cv::BORDER_REFLECT_101 puts at i
+    inline int reflect101(int i, int n) {
+        
+        if (n == 1) {
+            return 0;
+        }
+        
+        while (i < 0 || i >= n) {
+            i = i < 0 ? -i : 2 * n - 2 - i;
+        }
+        
+        return i;
+    }
+}
+
+FrameDifference::FrameDifference() :
+  threshold(0)
+, box_size(1) {
+    
+    updateMinCount();
+}
+
+void FrameDifference::set_threshold(int value) {
+    
+    value = std::min(std::max(value, 0), 255);
+    
+    if (value != threshold) {
+        threshold = value;
+        updateMinCount();
+    }
+}
+
+void FrameDifference::set_box_size(int value) {
+    
+    value = std::min(std::max(value, 1), FRAMEDIFFERENCE_MAX_BOX_SIZE);
+    
+    if (value != box_size) {
+        box_size = value;
+        updateMinCount();
+    }
+}
+
+void FrameDifference::updateMinCount() {
+    
+    // The blurred value is the box mean of a 0/255 image, rounded to the 
+    // nearest grey level
+    int area = box_size * box_size;
+    min_count = area + 1;
+    
+    for (int count = 0; count <= area; ++count) {
+        if (cv::saturate_cast<uchar>(255.0 * count / area) > threshold) {
+            min_count = count;
+            break;
+        }
+    }
+}
+
+void FrameDifference::apply(const cv::Mat& current, const cv::Mat& previous, cv::Mat& mask) {
+    
+    apply(current, previous, mask, 0, current.rows);
+}
+
+void FrameDifference::apply(const cv::Mat& current, const cv::Mat& previous, cv::Mat& mask, 
+                            int y_begin, int y_end) {
+    
+    CV_Assert(current.type() == CV_8UC1 && previous.type() == CV_8UC1 && mask.type() == CV_8UC1);
+    CV_Assert(current.size() == previous.size() && current.size() == mask.size());
+    CV_Assert(y_begin >= 0 && y_begin <= y_end && y_end <= current.rows);
+    
+    int rows = current.rows;
+    int cols = current.cols;
+    
+    if (y_begin == y_end || cols == 0) {
+        return;
+    }
+    
+    if (box_size == 1) {
+        
+        uchar pass = min_count <= 1 ? 255 : 0;
+        
+        for (int y = y_begin; y < y_end; ++y) {
+            uchar* out = mask.ptr<uchar>(y);
+            changedRow(current.ptr<uchar>(y), previous.ptr<uchar>(y), out, cols);
+            for (int x = 0; x < cols; ++x) {
+                out[x] = out[x] ? pass : 0;
+            }
+        }
+        
+        return;
+    }
+    
+    int anchor = box_size / 2;
+    size_t padded_cols = cols + box_size - 1;
+    
+    // Neither reallocates once the buffers have grown to the frame width
+    column_sums.assign(padded_cols, 0);
+    changes.resize(padded_cols);
+    
+    for (int j = 0; j < box_size; ++j) {
+        addRow(current, previous, reflect101(y_begin + j - anchor, rows), 1);
+    }
+    
+    for (int y = y_begin; y < y_end; ++y) {
+        
+        // Move the box down a row
+        if (y > y_begin) {
+            addRow(current, previous, reflect101(y - 1 - anchor, rows), -1);
+            addRow(current, previous, reflect101(y - 1 - anchor + box_size, rows), 1);
+        }
+        
+        // and slide it along
+        const uint16_t* sums = column_sums.data();
+        uchar* out = mask.ptr<uchar>(y);
+        int count = 0;
+        
+        for (int j = 0; j < box_size - 1; ++j) {
+            count += sums[j];
+        }
+        
+        for (int x = 0; x < cols; ++x) {
+            count += sums[x + box_size - 1];
+            out[x] = count >= min_count ? 255 : 0;
+            count -= sums[x];
+        }
+    }
+}
+
+void FrameDifference::addRow(const cv::Mat& current, const cv::Mat& previous, int y, int sign) {
+    
+    int cols = current.cols;
+    int anchor = box_size / 2;
+    int padded_cols = static_cast<int>(changes.size());
+    uchar* c = changes.data();
+    
+    changedRow(current.ptr<uchar>(y), previous.ptr<uchar>(y), c + anchor, cols);
+    
+    for (int i = 0; i < anchor; ++i) {
+        c[i] = c[anchor + reflect101(i - anchor, cols)];
+    }
+    for (int i = anchor + cols; i < padded_cols; ++i) {
+        c[i] = c[anchor + reflect101(i - anchor, cols)];
+    }
+    
+    uint16_t* sums = column_sums.data();
+    int i = 0;
+    
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    
+    for (; i + 16 <= padded_cols; i += 16) {
+        
+        __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + i));
+        __m128i lo = _mm_unpacklo_epi8(row, zero);
+        __m128i hi = _mm_unpackhi_epi8(row, zero);
+        __m128i sum_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i));
+        __m128i sum_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i + 8));
+        
+        if (sign > 0) {
+            sum_lo = _mm_add_epi16(sum_lo, lo);
+            sum_hi = _mm_add_epi16(sum_hi, hi);
+        } else {
+            sum_lo = _mm_sub_epi16(sum_lo, lo);
+            sum_hi = _mm_sub_epi16(sum_hi, hi);
+        }
+        
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i), sum_lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i + 8), sum_hi);
+    }
+#endif
+    
+    for (; i < padded_cols; ++i) {
+        sums[i] += sign * c[i];
+    }
+}
+
+void FrameDifference::changedRow(const uchar* a, const uchar* b, uchar* out, int width) const {
+    
+    // No 8-bit difference exceeds 255
+    if (threshold >= 255) {
+        std::memset(out, 0, width);
+        return;
+    }
+    
+    int x = 0;
+    
+#if defined(__SSE2__)
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold + 1));
+    const __m128i one = _mm_set1_epi8(1);
+    
+    for (; x + 16 <= width; x += 16) {
+        
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        __m128i changed = _mm_cmpeq_epi8(_mm_max_epu8(diff, limit), diff);
+        
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_and_si128(changed, one));
+    }
+#endif
+    
+    for (; x < width; ++x) {
+        out[x] = std::abs(a[x] - b[x]) > threshold;
+    }
+}
@@ -0,0 +1,81 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef FRAMEDIFFERENCE_H
+#define	FRAMEDIFFERENCE_H
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+
+// Largest box whose pixel counts fit the 16-bit column sums
+#define FRAMEDIFFERENCE_MAX_BOX_SIZE 255
+
+/**
+ * Motion mask of two 8-bit grey frames in a single pass. Gives the same 
+ * result as cv::absdiff, cv::threshold(THRESH_BINARY) to 0/255, cv::blur 
+ * with a box_size square box, and cv::threshold again. The box is reduced to
+ * a count of changed pixels, kept as running column sums, so no intermediate
+ * image is written. Scratch buffers are reused between calls.
+ */
+class FrameDifference {
+public:
+    
+    FrameDifference(void);
+    
+    // Grey level change a pixel must exceed, and the box blur threshold
+    void set_threshold(int value);
+    
+    // Side of the box in pixels. 1 or less for no blur.
+    void set_box_size(int value);
+    
+    /**
+     * Write a mask that is 255 where there was motion between previous and 
+     * current and 0 elsewhere. mask must already be CV_8UC1 and the size of
+     * the inputs; it is written in place and never reallocated, so it may be
+     * a view into a larger image.
+     */
+    void apply(const cv::Mat& current, const cv::Mat& previous, cv::Mat& mask);
+    
+    // Only rows [y_begin, y_end) of the mask. The box still reaches into the
+    // rows around them, so bands of a frame can be done independently.
+    void apply(const cv::Mat& current, const cv::Mat& previous, cv::Mat& mask, 
+               int y_begin, int y_end);
+    
+private:
+    
+    int threshold;
+    int box_size;
+    
+    // Changed pixels within a box needed for the blurred value to pass the
+    // threshold
+    int min_count;
+    
+    // Per column count of changed pixels over the box's rows, and one row of 
+    // changes. Both are padded by the reflected border.
+    std::vector<uint16_t> column_sums;
+    std::vector<uchar> changes;
+    
+    void updateMinCount(void);
+    
+    // Accumulate (sign 1) or remove (sign -1) row y's changes
+    void addRow(const cv::Mat& current, const cv::Mat& previous, int y, int sign);
+    
+    // 1 where the pixels differ by more than threshold, 0 elsewhere
+    void changedRow(const uchar* a, const uchar* b, uchar* out, int width) const;
+};
+
+#endif	/* FRAMEDIFFERENCE_H */
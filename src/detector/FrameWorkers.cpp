@@ -0,0 +1,129 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "FrameWorkers.h"
+
+#include <algorithm>
+
+FrameWorkers::FrameWorkers(int number_of_workers, 
+                           std::function<void(int)> process_frame, 
+                           std::function<void(int)> publish_frame) :
+  process(process_frame)
+, publish(publish_frame)
+, slots(std::max(number_of_workers, 1), SlotState::FREE)
+, next_submit(0)
+, next_publish(0)
+, stopping(false) {
+    
+    for (int i = 0; i < get_workers(); ++i) {
+        workers.push_back(std::thread(&FrameWorkers::work, this, i));
+    }
+    
+    publisher = std::thread(&FrameWorkers::publishInOrder, this);
+}
+
+FrameWorkers::~FrameWorkers() {
+    
+    // Frames already submitted are still processed and published
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    
+    changed.notify_all();
+    
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    publisher.join();
+}
+
+int FrameWorkers::acquire() {
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    int index = static_cast<int>(next_submit % slots.size());
+    changed.wait(lock, [&] { return slots[index] == SlotState::FREE; });
+    
+    return index;
+}
+
+void FrameWorkers::submit() {
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        slots[next_submit % slots.size()] = SlotState::QUEUED;
+        ++next_submit;
+    }
+    
+    changed.notify_all();
+}
+
+void FrameWorkers::work(int index) {
+    
+    while (true) {
+        
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return stopping || slots[index] == SlotState::QUEUED; });
+            
+            if (slots[index] != SlotState::QUEUED) {
+                return;
+            }
+        }
+        
+        process(index);
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slots[index] = SlotState::DONE;
+        }
+        
+        changed.notify_all();
+    }
+}
+
+void FrameWorkers::publishInOrder() {
+    
+    while (true) {
+        
+        int index;
+        
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            index = static_cast<int>(next_publish % slots.size());
+            
+            // When stopping, return once every submitted frame is published
+            changed.wait(lock, [&] { 
+                return slots[index] == SlotState::DONE || (stopping && next_publish == next_submit); 
+            });
+            
+            if (slots[index] != SlotState::DONE) {
+                return;
+            }
+        }
+        
+        publish(index);
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slots[index] = SlotState::FREE;
+            ++next_publish;
+        }
+        
+        changed.notify_all();
+    }
+}
@@ -0,0 +1,82 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef FRAMEWORKERS_H
+#define	FRAMEWORKERS_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Persistent threads that each process every Nth frame, with the results
+ * published in the order the frames were submitted. Worker i takes frames
+ * i, i + N, i + 2N, ..., so the N slots form a reorder buffer keyed by frame
+ * sequence: a result is published only after those of all earlier frames,
+ * and a slot is not refilled until its result has been published. On 
+ * destruction every frame already submitted is processed and published 
+ * before the threads stop.
+ */
+class FrameWorkers {
+public:
+    
+    /**
+     * @param workers Number of worker threads.
+     * @param process Called as process(worker) on that worker's thread once
+     * its input has been submitted.
+     * @param publish Called as publish(worker) on a single publishing thread,
+     * in submission order, once processing is done.
+     */
+    FrameWorkers(int workers, 
+                 std::function<void(int)> process, 
+                 std::function<void(int)> publish);
+    ~FrameWorkers();
+    
+    int get_workers(void) const { return static_cast<int>(slots.size()); }
+    
+    // Wait until the worker for the next frame is free and return its index.
+    // Its input can then be written until submit is called.
+    int acquire(void);
+    
+    // Hand the frame to the worker returned by the last acquire call
+    void submit(void);
+    
+private:
+    
+    enum class SlotState { FREE, QUEUED, DONE };
+    
+    std::function<void(int)> process, publish;
+    
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<SlotState> slots;
+    
+    // Frame sequence numbers. Frame n belongs to slot n % workers.
+    uint64_t next_submit, next_publish;
+    bool stopping;
+    
+    std::vector<std::thread> workers;
+    std::thread publisher;
+    
+    void work(int index);
+    void publishInOrder(void);
+};
+
+#endif	/* FRAMEWORKERS_H */
+
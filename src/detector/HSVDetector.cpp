@@ -31,101 +31,182 @@ HSVDetector::HSVDetector(std::string image_source_name, std::string position_sin
         int s_min_in, int s_max_in,
         int v_min_in, int v_max_in) :
 Detector(image_source_name, position_sink_name)
-, h_min(h_min_in)
-, h_max(h_max_in)
-, s_min(s_min_in)
-, s_max(s_max_in)
-, v_min(v_min_in)
-, v_max(v_max_in)
+, sliders(parameters, &parameters_mutex)
+, lut_on(false)
 , name(position_sink_name + "_hsv") {
 
     tuning_on = false;
+    
+    parameters.h_min = h_min_in;
+    parameters.h_max = h_max_in;
+    parameters.s_min = s_min_in;
+    parameters.s_max = s_max_in;
+    parameters.v_min = v_min_in;
+    parameters.v_max = v_max_in;
 
     // Set defaults for the erode and dilate blocks
     set_erode_size(0);
     set_dilate_size(10);
-
-    // Initialize area parameters without constraint
-    min_object_area = 0;
-    max_object_area = std::numeric_limits<double>::max(); //TODO: These are not being used and would be helpful, esp max_area!
 }
 
 HSVDetector::HSVDetector(std::string source_name, std::string pos_sink_name) :
 HSVDetector::HSVDetector(source_name, pos_sink_name, 0, 256, 0, 256, 0, 256) {
 }
 
-void HSVDetector::erodeSliderChangedCallback(int value, void* object) {
-    HSVDetector* hsv_detector = (HSVDetector*) object;
-    hsv_detector->set_erode_size(value);
-}
-
-void HSVDetector::dilateSliderChangedCallback(int value, void* object) {
-    HSVDetector* hsv_detector = (HSVDetector*) object;
-    hsv_detector->set_dilate_size(value);
-}
-
 void HSVDetector::findObjectAndServePosition() {
 
+    if (frame_workers) {
+        dispatchFrame();
+        return;
+    }
+    
     // If we are able to get a an image
-    if (image_source.getSharedMat(hsv_image)) {
+    if (image_source.getSharedMat(work.frame)) {
 
+        int64_t enter_ns = shmem::Sample::nowInNs();
+        work.object_position.sample = image_source.get_sample();
         addWorldReferenceFrame();
-        cv::cvtColor(hsv_image, hsv_image, cv::COLOR_BGR2HSV);
-        applyThreshold();
-        clarifyBlobs();
-        siftBlobs();
+        startSearch(work.frame.size());
+        work.window = search_window;
+        takeParameters(work);
+        detect(work);
+        endSearch(work.object_position.position_valid, work.object_position.position, std::sqrt(work.object_area / PI));
         tune();
 
-        position_sink.pushObject(object_position);
+        work.object_position.sample.addStage(position_sink->get_stage(), enter_ns);
+        position_sink->pushObject(work.object_position);
     }
 }
 
-void HSVDetector::applyThreshold() {
-
-    cv::inRange(hsv_image, cv::Scalar(h_min, s_min, v_min), cv::Scalar(h_max, s_max, v_max), threshold_image);
-    hsv_image.setTo(0, threshold_image == 0);
+void HSVDetector::dispatchFrame() {
+    
+    cv::Mat shared_frame;
+    
+    if (image_source.getSharedMat(shared_frame)) {
+        
+        int64_t enter_ns = shmem::Sample::nowInNs();
+        
+        // Waits for the result of the frame this worker had last to be 
+        // published
+        Work& w = *worker_work[frame_workers->acquire()];
+        
+        // The view is only valid until the next getSharedMat call
+        shared_frame.copyTo(w.frame);
+        image_source.releaseSharedMat();
+        
+        w.enter_ns = enter_ns;
+        w.object_position.sample = image_source.get_sample();
+        addWorldReferenceFrame(w.object_position);
+        w.window = cv::Rect();
+        takeParameters(w);
+        
+        frame_workers->submit();
+    }
+}
 
+void HSVDetector::takeParameters(Work& w) {
+    
+    std::lock_guard<std::mutex> lock(parameters_mutex);
+    w.parameters = parameters;
 }
 
-void HSVDetector::clarifyBlobs() {
+void HSVDetector::set_frame(const cv::Mat& frame) {
+    
+    work.frame = frame;
+    work.window = cv::Rect();
+    takeParameters(work);
+}
 
-    if (erode_on) {
-        cv::erode(threshold_image, threshold_image, erode_element);
+void HSVDetector::set_frame_workers(int value) {
+    
+    frame_workers.reset();
+    worker_work.clear();
+    
+    if (value < 2) {
+        return;
     }
-
-    if (dilate_on) {
-        cv::dilate(threshold_image, threshold_image, dilate_element);
+    
+    if (get_threads() > 1) {
+        std::cerr << "Frame workers replace band threads. Using one thread per frame." << std::endl;
+        set_threads(1);
     }
-
+    
+    for (int i = 0; i < value; ++i) {
+        worker_work.push_back(std::unique_ptr<Work>(new Work));
+        worker_work.back()->color_lut.set_bits(work.color_lut.get_bits());
+    }
+    
+    frame_workers.reset(new FrameWorkers(value, 
+        [this](int worker) { 
+            detect(*worker_work[worker]); 
+        },
+        [this](int worker) {
+            Work& w = *worker_work[worker];
+            tune(w);
+            w.object_position.sample.addStage(position_sink->get_stage(), w.enter_ns);
+            position_sink->pushObject(w.object_position);
+        }));
 }
 
-void HSVDetector::siftBlobs() {
-
-    cv::Mat thesh_cpy = threshold_image.clone();
-    std::vector< std::vector < cv::Point > > contours;
-    std::vector< cv::Vec4i > hierarchy;
+void HSVDetector::detect(Work& w) {
+    
+    applyThreshold(w);
+    clarifyBlobs(w);
+    siftBlobs(w);
+}
 
-    // This function will modify the threshold_img data.
-    cv::findContours(thesh_cpy, contours, hierarchy, cv::RETR_CCOMP, cv::CHAIN_APPROX_SIMPLE);
+void HSVDetector::applyThreshold(Work& w) {
 
-    object_area = 0;
-    object_position.position_valid = false;
+    // Bounds are reapplied every frame because the tuning sliders change 
+    // them
+    w.parameters.applyBounds(w.hsv_threshold);
+    
+    if (lut_on) {
+        w.color_lut.update(&w.hsv_threshold, 1);
+    }
+    
+    cv::Mat view = w.window.area() > 0 ? w.frame(w.window) : w.frame;
+    w.threshold_image.create(view.size(), CV_8UC1);
+    
+    forEachBand(view.rows, [&](int, const cv::Range& rows) {
+        
+        cv::Mat mask = w.threshold_image.rowRange(rows);
+        
+        if (lut_on) {
+            w.color_lut.apply(view.rowRange(rows), &mask);
+        } else {
+            w.hsv_threshold.apply(view.rowRange(rows), mask);
+        }
+    });
+}
 
-    if (hierarchy.size() > 0) {
+void HSVDetector::clarifyBlobs(Work& w) {
 
-        for (int index = 0; index >= 0; index = hierarchy[index][0]) {
+    clarify(w.threshold_image, w.clarify_image, 
+            w.parameters.erode_on, w.parameters.erode_element, 
+            w.parameters.dilate_on, w.parameters.dilate_element);
+}
 
-            cv::Moments moment = cv::moments((cv::Mat)contours[index]);
-            double area = moment.m00;
+void HSVDetector::siftBlobs() {
+    
+    siftBlobs(work);
+}
 
-            // Isolate the largest contour within the min/max range.
-            if (area > min_object_area && area < max_object_area && area > object_area) {
-                object_position.position.x = moment.m10 / area;
-                object_position.position.y = moment.m01 / area;
-                object_position.position_valid = true;
-                object_area = area;
-            }
-        }
+void HSVDetector::siftBlobs(Work& w) {
+
+    // Reads the threshold image without modifying it, so it needs no copy
+    findBlobs(w.threshold_image, w.blobs);
+    const Blob* object = w.blobs.largest(min_object_area, max_object_area);
+
+    if (object != nullptr) {
+        cv::Point2f centroid = object->centroid();
+        w.object_position.position.x = centroid.x + w.window.x;
+        w.object_position.position.y = centroid.y + w.window.y;
+        w.object_position.position_valid = true;
+        w.object_area = static_cast<double>(object->area);
+    } else {
+        w.object_position.position_valid = false;
+        w.object_area = 0;
     }
 
     if (tuning_on) {
@@ -134,44 +215,49 @@ void HSVDetector::siftBlobs() {
         int baseline = 0;
         cv::Size textSize = cv::getTextSize(msg, 1, 1, 1, &baseline);
         cv::Point text_origin(
-                threshold_image.cols - 2 * textSize.width - 10,
-                threshold_image.rows - 2 * baseline - 10);
+                w.threshold_image.cols - 2 * textSize.width - 10,
+                w.threshold_image.rows - 2 * baseline - 10);
 
         // Plot a circle representing found object
-        if (object_position.position_valid) {
-            auto radius = std::sqrt(object_area / PI);
+        if (w.object_position.position_valid) {
+            auto radius = std::sqrt(w.object_area / PI);
             cv::Point center;
-            center.x = object_position.position.x;
-            center.y = object_position.position.y;
-            cv::circle(threshold_image, center, radius, cv::Scalar(0, 0, 255), 2);
+            center.x = w.object_position.position.x;
+            center.y = w.object_position.position.y;
+            cv::circle(w.threshold_image, center, radius, cv::Scalar(0, 0, 255), 2);
   
             // Tell object position
-            if (object_position.world_coords_valid) {
-                shmem::Position3D covert_pos = object_position.convertPositionToWorldCoords(object_position.position);
+            if (w.object_position.world_coords_valid) {
+                shmem::Position3D covert_pos = w.object_position.convertPositionToWorldCoords(w.object_position.position);
                 msg = cv::format("(%d, %d) world units", (int) covert_pos.x, (int) covert_pos.y);
-                cv::putText(threshold_image, msg, text_origin, 1, 1, cv::Scalar(0, 255, 0));
+                cv::putText(w.threshold_image, msg, text_origin, 1, 1, cv::Scalar(0, 255, 0));
             } else {
-                msg = cv::format("(%d, %d) pixels", (int) object_position.position.x, (int) object_position.position.y);
-                cv::putText(threshold_image, msg, text_origin, 1, 1, cv::Scalar(0, 255, 0));
+                msg = cv::format("(%d, %d) pixels", (int) w.object_position.position.x, (int) w.object_position.position.y);
+                cv::putText(w.threshold_image, msg, text_origin, 1, 1, cv::Scalar(0, 255, 0));
             }
         } else {
             msg = "Object not found";
-            cv::putText(threshold_image, msg, text_origin, 1, 1, cv::Scalar(0, 255, 0));
+            cv::putText(w.threshold_image, msg, text_origin, 1, 1, cv::Scalar(0, 255, 0));
         }
     }
 }
 
     void HSVDetector::addWorldReferenceFrame() {
+        
+        addWorldReferenceFrame(work.object_position);
+    }
+
+    void HSVDetector::addWorldReferenceFrame(shmem::Position& position) {
 
         if (image_source.get_world_coords_valid()) {
 
-            object_position.world_coords_valid = true;
+            position.world_coords_valid = true;
 
-            object_position.xyz_origin_in_px.x = image_source.get_xy_origin_in_px().x;
-            object_position.xyz_origin_in_px.y = image_source.get_xy_origin_in_px().y;
+            position.xyz_origin_in_px.x = image_source.get_xy_origin_in_px().x;
+            position.xyz_origin_in_px.y = image_source.get_xy_origin_in_px().y;
 
-            object_position.worldunits_per_px_x = image_source.get_worldunits_per_px_x();
-            object_position.worldunits_per_px_y = image_source.get_worldunits_per_px_y();
+            position.worldunits_per_px_x = image_source.get_worldunits_per_px_x();
+            position.worldunits_per_px_y = image_source.get_worldunits_per_px_y();
 
         }
     }
@@ -205,47 +291,34 @@ void HSVDetector::siftBlobs() {
 
                 auto this_config = *config.get_table(key);
 
-                if (this_config.contains("erode")) {
-                    set_erode_size((int) (*this_config.get_as<int64_t>("erode")));
-                }
+                configureTransport(this_config);
+                parameters.configure(this_config);
 
-                if (this_config.contains("dilate")) {
-                    set_dilate_size((int) (*this_config.get_as<int64_t>("dilate")));
+                if (this_config.contains("lut_bits")) {
+                    lut_on = true;
+                    work.color_lut.set_bits((int) (*this_config.get_as<int64_t>("lut_bits")));
                 }
 
-                if (this_config.contains("h_thresholds")) {
-                    auto t = *this_config.get_table("h_thresholds");
-
-                    if (t.contains("min")) {
-                        h_min = (int) (*t.get_as<int64_t>("min"));
-                    }
-                    if (t.contains("max")) {
-                        h_max = (int) (*t.get_as<int64_t>("max"));
-                    }
+                if (this_config.contains("buffer_depth")) {
+                    position_sink->set_buffer_depth((size_t) (*this_config.get_as<int64_t>("buffer_depth")));
                 }
-
-                if (this_config.contains("s_thresholds")) {
-                    auto t = *this_config.get_table("s_thresholds");
-
-                    if (t.contains("min")) {
-                        s_min = (int) (*t.get_as<int64_t>("min"));
-                    }
-                    if (t.contains("max")) {
-                        s_max = (int) (*t.get_as<int64_t>("max"));
-                    }
+                
+                shmem::OverflowPolicy policy;
+                if (shmem::parseOverflowPolicy(this_config, policy)) {
+                    position_sink->set_overflow_policy(policy);
                 }
-
-                if (this_config.contains("v_thresholds")) {
-                    auto t = *this_config.get_table("v_thresholds");
-
-                    if (t.contains("min")) {
-                        v_min = (int) (*t.get_as<int64_t>("min"));
-                    }
-                    if (t.contains("max")) {
-                        v_max = (int) (*t.get_as<int64_t>("max"));
+                
+                configureObjectArea(this_config);
+                configureTracking(this_config);
+                configureThreads(this_config);
+                
+                if (this_config.contains("frame_workers")) {
+                    set_frame_workers((int) (*this_config.get_as<int64_t>("frame_workers")));
+                    if (frame_workers && this_config.contains("tracking")) {
+                        std::cerr << "Frame workers do not use search window tracking." << std::endl;
                     }
                 }
-
+                
                 if (this_config.contains("tune")) {
                     if (*this_config.get_as<bool>("tune")) {
                         tuning_on = true;
@@ -263,12 +336,17 @@ void HSVDetector::siftBlobs() {
     }
 
     void HSVDetector::tune() {
+        
+        tune(work);
+    }
+
+    void HSVDetector::tune(Work& w) {
 
         if (tuning_on) {
             if (!tuning_windows_created) {
                 createTuningWindows();
             }
-            cv::imshow(tuning_image_title, threshold_image);
+            cv::imshow(tuning_image_title, w.threshold_image);
             cv::waitKey(1);
         } else if (!tuning_on && tuning_windows_created) {
             // Destroy the tuning windows
@@ -284,35 +362,19 @@ void HSVDetector::siftBlobs() {
         cv::namedWindow(slider_title, cv::WINDOW_AUTOSIZE);
 
         // Create sliders and insert them into window
-        cv::createTrackbar("H_MIN", slider_title, &h_min, 256);
-        cv::createTrackbar("H_MAX", slider_title, &h_max, 256);
-        cv::createTrackbar("S_MIN", slider_title, &s_min, 256);
-        cv::createTrackbar("S_MAX", slider_title, &s_max, 256);
-        cv::createTrackbar("V_MIN", slider_title, &v_min, 256);
-        cv::createTrackbar("V_MAX", slider_title, &v_max, 256);
-        cv::createTrackbar("ERODE", slider_title, &erode_px, 50, &HSVDetector::erodeSliderChangedCallback, this);
-        cv::createTrackbar("DILATE", slider_title, &dilate_px, 50, &HSVDetector::dilateSliderChangedCallback, this);
+        sliders.create(slider_title);
 
         tuning_windows_created = true;
     }
 
     void HSVDetector::set_erode_size(int value) {
 
-        if (value > 0) {
-            erode_on = true;
-            erode_px = value;
-            erode_element = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(erode_px, erode_px));
-        } else {
-            erode_on = false;
-        }
+        std::lock_guard<std::mutex> lock(parameters_mutex);
+        parameters.set_erode_size(value);
     }
 
     void HSVDetector::set_dilate_size(int value) {
-        if (value > 0) {
-            dilate_on = true;
-            dilate_px = value;
-            dilate_element = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(dilate_px, dilate_px));
-        } else {
-            dilate_on = false;
-        }
+
+        std::lock_guard<std::mutex> lock(parameters_mutex);
+        parameters.set_dilate_size(value);
     }
@@ -17,10 +17,17 @@
 #ifndef HSVFILTER_H
 #define	HSVFILTER_H
 
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <opencv2/core/mat.hpp>
 
 #include "Detector.h"
+#include "ColorLUT.h"
+#include "FrameWorkers.h"
+#include "HSVParameters.h"
+#include "HSVThreshold.h"
 
 #define PI 3.14159265358979323846
 
@@ -47,56 +54,106 @@ public:
 
     // Accessors
     std::string get_detector_name() { return name; }
-    void set_min_object_area(double value) { min_object_area = value; }
-    void set_max_object_area(double value) { max_object_area = value; }
     void set_erode_size(int erode_px);
     void set_dilate_size(int dilate_px);
     
+    /**
+     * Detect in this many frames at once, each on its own thread, and 
+     * publish the positions in capture order. Frames are copied out of 
+     * shared memory and search window tracking is not used. Replaces band
+     * threads. Call after lut_bits has been set.
+     */
+    void set_frame_workers(int value);
+    
+    /**
+     * The detection stages, for running one at a time on a frame that is not
+     * in shared memory. set_frame searches the whole of frame, which must 
+     * outlive the stages. Call the stages in order.
+     */
+    void set_frame(const cv::Mat& frame);
+    void applyThreshold(void) { applyThreshold(work); }
+    void clarifyBlobs(void) { clarifyBlobs(work); }
+    void siftBlobs(void);
+    void tune(void);
+    
+    // Results of the stages above
+    const cv::Mat& get_threshold_image(void) const { return work.threshold_image; }
+    const shmem::Position& get_object_position(void) const { return work.object_position; }
+    
+    // Reference classification using the thresholds of the last applyThreshold
+    const HSVThreshold& get_hsv_threshold(void) const { return work.hsv_threshold; }
+    
+    // Table resolution in bits per channel, or 0 when the table is off
+    int get_lut_bits(void) const { return lut_on ? work.color_lut.get_bits() : 0; }
+    
 private:
     
-    // Sizes of the erode and dilate blocks
-    int erode_px, dilate_px;
-    bool erode_on, dilate_on;
-    cv::Mat hsv_image, threshold_image, erode_element, dilate_element;
-
-    // HSV threshold values
-    int h_min;
-    int h_max;
-    int s_min;
-    int s_max;
-    int v_min;
-    int v_max;
+    // Everything that detection in one frame writes to. Frame workers each 
+    // have their own.
+    struct Work {
+        cv::Mat frame, threshold_image;
+        cv::Mat clarify_image; // Swapped with threshold_image when threaded
+        cv::Rect window; // Search window, or empty for the whole frame
+        HSVParameters parameters; // As they were when the frame arrived
+        HSVThreshold hsv_threshold;
+        ColorLUT color_lut;
+        BlobFinder blobs;
+        double object_area;
+        shmem::Position object_position;
+        int64_t enter_ns;
+        
+        Work() : object_area(0), enter_ns(0) { }
+    };
+    
+    Work work;
+    
+    // HSV thresholds and erode/dilate sizes, and the sliders that tune them.
+    // The sliders run on whichever thread calls tune, which with frame 
+    // workers is not the one that reads the parameters, so each frame works
+    // from its own copy.
+    HSVParameters parameters;
+    std::mutex parameters_mutex;
+    HSVSliders sliders;
+    
+    // Classify by table lookup rather than conversion
+    bool lut_on;
 
     // For manual manipulation of HSV filtering
     const std::string name;
 
-    // Object detection
-    double object_area;
-    shmem::Position object_position;
-
-    double min_object_area;
-    double max_object_area;
+    // Frame parallel detection. Declared after worker_work so that the 
+    // threads are stopped before it goes.
+    std::vector<std::unique_ptr<Work> > worker_work;
+    std::unique_ptr<FrameWorkers> frame_workers;
     
     // Mat server for sending processed frames
     //bool frame_sink_used;
     //MatServer frame_sink;
     
     void addWorldReferenceFrame(void);
-
-    // Binary threshold and use the binary threshold to mask the image
-    void applyThreshold(void);
+    void addWorldReferenceFrame(shmem::Position& position);
+    
+    // Copy the current parameters into w
+    void takeParameters(Work& w);
+    
+    // Copy the next frame to a free worker
+    void dispatchFrame(void);
+    
+    // All of the stages below
+    void detect(Work& w);
+    
+    // Binary threshold of the BGR frame's HSV values, in one pass
+    void applyThreshold(Work& w);
 
     // Erode/dilate objects to get rid of speckles
-    void clarifyBlobs(void);
+    void clarifyBlobs(Work& w);
     
     // Sift through thresholded blobs to pull out potential object
-    void siftBlobs(void);
+    void siftBlobs(Work& w);
     
     // Sliders to allow manipulation of HSV thresholds
-    void tune(void);
+    void tune(Work& w);
     void createTuningWindows(void);
-    static void erodeSliderChangedCallback(int, void*);
-    static void dilateSliderChangedCallback(int, void*);
 };
 
 #endif	/* HSVFILTER_H */
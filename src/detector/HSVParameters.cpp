@@ -0,0 +1,143 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "HSVParameters.h"
+
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+namespace {
+    
+    // Read an optional KEY = {min = N, max = N} table
+    void configureRange(cpptoml::table& config, const std::string& key, int& min, int& max) {
+        
+        if (config.contains(key)) {
+            auto t = *config.get_table(key);
+
+            if (t.contains("min")) {
+                min = (int) (*t.get_as<int64_t>("min"));
+            }
+            if (t.contains("max")) {
+                max = (int) (*t.get_as<int64_t>("max"));
+            }
+        }
+    }
+}
+
+HSVParameters::HSVParameters() :
+  h_min(0)
+, h_max(256)
+, s_min(0)
+, s_max(256)
+, v_min(0)
+, v_max(256)
+, erode_px(0)
+, dilate_px(0)
+, erode_on(false)
+, dilate_on(false) { }
+
+void HSVParameters::set_erode_size(int value) {
+
+    erode_px = std::max(value, 0);
+    erode_on = erode_px > 0;
+    
+    if (erode_on) {
+        erode_element = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(erode_px, erode_px));
+    }
+}
+
+void HSVParameters::set_dilate_size(int value) {
+
+    dilate_px = std::max(value, 0);
+    dilate_on = dilate_px > 0;
+    
+    if (dilate_on) {
+        dilate_element = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(dilate_px, dilate_px));
+    }
+}
+
+void HSVParameters::configure(cpptoml::table& config) {
+    
+    if (config.contains("erode")) {
+        set_erode_size((int) (*config.get_as<int64_t>("erode")));
+    }
+
+    if (config.contains("dilate")) {
+        set_dilate_size((int) (*config.get_as<int64_t>("dilate")));
+    }
+    
+    configureRange(config, "h_thresholds", h_min, h_max);
+    configureRange(config, "s_thresholds", s_min, s_max);
+    configureRange(config, "v_thresholds", v_min, v_max);
+}
+
+HSVSliders::HSVSliders(HSVParameters& parameters_in, std::mutex* mutex_in) :
+  parameters(parameters_in)
+, mutex(mutex_in) { 
+    
+    std::fill(values, values + NUMBER_OF_SLIDERS, 0);
+}
+
+void HSVSliders::create(const std::string& window_name) {
+    
+    {
+        std::unique_lock<std::mutex> lk;
+        if (mutex) {
+            lk = std::unique_lock<std::mutex>(*mutex);
+        }
+        
+        values[H_MIN] = parameters.h_min;
+        values[H_MAX] = parameters.h_max;
+        values[S_MIN] = parameters.s_min;
+        values[S_MAX] = parameters.s_max;
+        values[V_MIN] = parameters.v_min;
+        values[V_MAX] = parameters.v_max;
+        values[ERODE] = parameters.erode_px;
+        values[DILATE] = parameters.dilate_px;
+    }
+    
+    const char* names[] = {"H_MIN", "H_MAX", "S_MIN", "S_MAX", "V_MIN", "V_MAX", "ERODE", "DILATE"};
+    
+    for (int i = 0; i < NUMBER_OF_SLIDERS; ++i) {
+        cv::createTrackbar(names[i], window_name, &values[i], i < ERODE ? 256 : 50, 
+                           &HSVSliders::sliderChangedCallback, this);
+    }
+}
+
+void HSVSliders::sliderChangedCallback(int, void* object) {
+    
+    HSVSliders* sliders = (HSVSliders*) object;
+    HSVParameters& p = sliders->parameters;
+    
+    std::unique_lock<std::mutex> lk;
+    if (sliders->mutex) {
+        lk = std::unique_lock<std::mutex>(*sliders->mutex);
+    }
+    
+    p.h_min = sliders->values[H_MIN];
+    p.h_max = sliders->values[H_MAX];
+    p.s_min = sliders->values[S_MIN];
+    p.s_max = sliders->values[S_MAX];
+    p.v_min = sliders->values[V_MIN];
+    p.v_max = sliders->values[V_MAX];
+    
+    if (sliders->values[ERODE] != p.erode_px) {
+        p.set_erode_size(sliders->values[ERODE]);
+    }
+    if (sliders->values[DILATE] != p.dilate_px) {
+        p.set_dilate_size(sliders->values[DILATE]);
+    }
+}
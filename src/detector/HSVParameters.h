@@ -0,0 +1,78 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef HSVPARAMETERS_H
+#define	HSVPARAMETERS_H
+
+#include <mutex>
+#include <string>
+#include <opencv2/core/mat.hpp>
+
+#include "../../lib/cpptoml/cpptoml.h"
+#include "HSVThreshold.h"
+
+/**
+ * HSV pass bands and erode/dilate block sizes for one colour. Defaults to 
+ * the full HSV range with erode and dilate off.
+ */
+struct HSVParameters {
+    
+    HSVParameters(void);
+    
+    // HSV threshold values. A hue range with h_min > h_max wraps through 0.
+    int h_min, h_max, s_min, s_max, v_min, v_max;
+    
+    // Sizes of the erode and dilate blocks. Sizes below 1 turn them off.
+    int erode_px, dilate_px;
+    bool erode_on, dilate_on;
+    cv::Mat erode_element, dilate_element;
+    
+    void set_erode_size(int value);
+    void set_dilate_size(int value);
+    
+    void applyBounds(HSVThreshold& threshold) const {
+        threshold.set_bounds(h_min, h_max, s_min, s_max, v_min, v_max);
+    }
+    
+    // Read the optional erode, dilate and h/s/v_thresholds keys of config
+    void configure(cpptoml::table& config);
+};
+
+/**
+ * Tuning sliders for a set of HSVParameters. The sliders move values of 
+ * their own, which are then written to the parameters while holding mutex, 
+ * if there is one. The parameters must outlive the sliders.
+ */
+class HSVSliders {
+public:
+    
+    HSVSliders(HSVParameters& parameters, std::mutex* mutex);
+    
+    // Add a slider for each parameter to a named window
+    void create(const std::string& window_name);
+    
+private:
+    
+    enum { H_MIN, H_MAX, S_MIN, S_MAX, V_MIN, V_MAX, ERODE, DILATE, NUMBER_OF_SLIDERS };
+    
+    HSVParameters& parameters;
+    std::mutex* mutex;
+    int values[NUMBER_OF_SLIDERS];
+    
+    static void sliderChangedCallback(int, void*);
+};
+
+#endif	/* HSVPARAMETERS_H */
@@ -0,0 +1,571 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "HSVThreshold.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HSVTHRESHOLD_X86 1
+#include <immintrin.h>
+#else
+#define HSVTHRESHOLD_X86 0
+#endif
+
+// Fixed point precision of cvtColor's 8-bit HSV conversion
+#define HSV_SHIFT 12
+#define HSV_ROUND (1 << (HSV_SHIFT - 1))
+
+// Hue of 8-bit HSV images spans [0, 180)
+#define HSV_HUE_RANGE 180
+
+namespace {
+    
+    /**
+     * Reciprocal tables of cvtColor's 8-bit HSV conversion. S is 
+     * (diff * sdiv[v] + round) >> shift and H is (h * hdiv[diff] + round) >> 
+     * shift, with exactly the rounding that cvtColor uses.
+     */
+    struct HSVTables {
+        
+        int32_t sdiv[256];
+        int32_t hdiv[256];
+        
+        // pshufb masks that gather channel c of 16 BGR pixels out of the k'th
+        // 16 byte chunk of those pixels
+        uchar deinterleave[3][3][16];
+        
+        HSVTables(void) {
+            
+            sdiv[0] = hdiv[0] = 0;
+            for (int i = 1; i < 256; ++i) {
+                sdiv[i] = cv::saturate_cast<int>((255 << HSV_SHIFT) / (1. * i));
+                hdiv[i] = cv::saturate_cast<int>((HSV_HUE_RANGE << HSV_SHIFT) / (6. * i));
+            }
+            
+            for (int c = 0; c < 3; ++c) {
+                for (int k = 0; k < 3; ++k) {
+                    for (int i = 0; i < 16; ++i) {
+                        int byte = 3 * i + c - 16 * k;
+                        deinterleave[c][k][i] = (byte >= 0 && byte < 16) ? byte : 0x80;
+                    }
+                }
+            }
+        }
+    };
+    
+    const HSVTables& tables(void) {
+        static const HSVTables hsv_tables;
+        return hsv_tables;
+    }
+}
+
+HSVThreshold::HSVThreshold() {
+    
+    set_bounds(0, 255, 0, 255, 0, 255);
+}
+
+void HSVThreshold::set_bounds(int h_min, int h_max, int s_min, int s_max, int v_min, int v_max) {
+    
+    // cv::inRange saturates scalar bounds to the image depth
+    h_lo = std::min(std::max(h_min, 0), 255);
+    h_hi = std::min(std::max(h_max, 0), 255);
+    s_lo = std::min(std::max(s_min, 0), 255);
+    s_hi = std::min(std::max(s_max, 0), 255);
+    v_lo = std::min(std::max(v_min, 0), 255);
+    v_hi = std::min(std::max(v_max, 0), 255);
+    
+    hue_wraps = h_lo > h_hi;
+}
+
+bool HSVThreshold::operator==(const HSVThreshold& other) const {
+    
+    return h_lo == other.h_lo && h_hi == other.h_hi &&
+           s_lo == other.s_lo && s_hi == other.s_hi &&
+           v_lo == other.v_lo && v_hi == other.v_hi;
+}
+
+void HSVThreshold::apply(const cv::Mat& bgr, cv::Mat& mask) const {
+    
+    apply(bgr, this, &mask, 1, bestKernel());
+}
+
+void HSVThreshold::apply(const cv::Mat& bgr, cv::Mat& mask, Kernel kernel) const {
+    
+    apply(bgr, this, &mask, 1, kernel);
+}
+
+void HSVThreshold::apply(const cv::Mat& bgr, const HSVThreshold* thresholds, 
+                         cv::Mat* masks, int count) {
+    
+    apply(bgr, thresholds, masks, count, bestKernel());
+}
+
+void HSVThreshold::apply(const cv::Mat& bgr, const HSVThreshold* thresholds, 
+                         cv::Mat* masks, int count, Kernel kernel) {
+    
+    CV_Assert(bgr.type() == CV_8UC3);
+    CV_Assert(count > 0 && count <= HSVTHRESHOLD_MAX_CLASSES);
+    
+    if (!isSupported(kernel)) {
+        kernel = Kernel::SCALAR;
+    }
+    
+    int rows = bgr.rows;
+    int cols = bgr.cols;
+    bool continuous = bgr.isContinuous();
+    
+    for (int i = 0; i < count; ++i) {
+        masks[i].create(bgr.size(), CV_8UC1);
+        continuous = continuous && masks[i].isContinuous();
+    }
+    
+    if (continuous) {
+        cols *= rows;
+        rows = 1;
+    }
+    
+    uchar* out[HSVTHRESHOLD_MAX_CLASSES];
+    
+    for (int y = 0; y < rows; ++y) {
+        
+        const uchar* in = bgr.ptr<uchar>(y);
+        for (int i = 0; i < count; ++i) {
+            out[i] = masks[i].ptr<uchar>(y);
+        }
+        
+        switch (kernel) {
+            case Kernel::AVX2:
+                thresholdRowAVX2(in, out, thresholds, count, cols);
+                break;
+            case Kernel::SSE41:
+                thresholdRowSSE41(in, out, thresholds, count, cols);
+                break;
+            default:
+                thresholdRowScalar(in, out, thresholds, count, 0, cols);
+                break;
+        }
+    }
+}
+
+void HSVThreshold::applyReference(const cv::Mat& bgr, cv::Mat& mask) const {
+    
+    cv::Mat hsv;
+    cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+    
+    if (!hue_wraps) {
+        cv::inRange(hsv, cv::Scalar(h_lo, s_lo, v_lo), cv::Scalar(h_hi, s_hi, v_hi), mask);
+    } else {
+        cv::Mat low_hues;
+        cv::inRange(hsv, cv::Scalar(h_lo, s_lo, v_lo), cv::Scalar(255, s_hi, v_hi), mask);
+        cv::inRange(hsv, cv::Scalar(0, s_lo, v_lo), cv::Scalar(h_hi, s_hi, v_hi), low_hues);
+        cv::bitwise_or(mask, low_hues, mask);
+    }
+}
+
+HSVThreshold::Kernel HSVThreshold::bestKernel() {
+    
+    static const Kernel best = 
+        isSupported(Kernel::AVX2) ? Kernel::AVX2 :
+        isSupported(Kernel::SSE41) ? Kernel::SSE41 : Kernel::SCALAR;
+    
+    return best;
+}
+
+bool HSVThreshold::isSupported(Kernel kernel) {
+    
+    switch (kernel) {
+#if HSVTHRESHOLD_X86
+        case Kernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case Kernel::SSE41:
+            return __builtin_cpu_supports("sse4.1");
+#endif
+        case Kernel::SCALAR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string HSVThreshold::kernelName(Kernel kernel) {
+    
+    switch (kernel) {
+        case Kernel::AVX2:
+            return "avx2";
+        case Kernel::SSE41:
+            return "sse4.1";
+        default:
+            return "scalar";
+    }
+}
+
+bool HSVThreshold::passes(int h, int s) const {
+    
+    if (s < s_lo || s > s_hi) {
+        return false;
+    }
+    
+    bool above_lo = h >= h_lo;
+    bool below_hi = h <= h_hi;
+    
+    return hue_wraps ? (above_lo || below_hi) : (above_lo && below_hi);
+}
+
+void HSVThreshold::thresholdRowScalar(const uchar* bgr, uchar* const* masks, 
+        const HSVThreshold* thresholds, int count, int begin, int width) {
+    
+    const HSVTables& t = tables();
+    
+    for (int x = begin; x < width; ++x) {
+        
+        int b = bgr[3 * x];
+        int g = bgr[3 * x + 1];
+        int r = bgr[3 * x + 2];
+        
+        int v = std::max(b, std::max(g, r));
+        int diff = v - std::min(b, std::min(g, r));
+        
+        // H and S are only worked out once some set of bounds passes V
+        bool hs_known = false;
+        int h = 0, s = 0;
+        
+        for (int i = 0; i < count; ++i) {
+            
+            const HSVThreshold& bounds = thresholds[i];
+            
+            if (v < bounds.v_lo || v > bounds.v_hi) {
+                masks[i][x] = 0;
+                continue;
+            }
+            
+            if (!hs_known) {
+                
+                s = (diff * t.sdiv[v] + HSV_ROUND) >> HSV_SHIFT;
+                
+                // Hue sector is chosen by the largest channel, red first
+                if (v == r) {
+                    h = g - b;
+                } else if (v == g) {
+                    h = b - r + 2 * diff;
+                } else {
+                    h = r - g + 4 * diff;
+                }
+                
+                h = (h * t.hdiv[diff] + HSV_ROUND) >> HSV_SHIFT;
+                h += h < 0 ? HSV_HUE_RANGE : 0;
+                hs_known = true;
+            }
+            
+            masks[i][x] = bounds.passes(h, s) ? 255 : 0;
+        }
+    }
+}
+
+#if HSVTHRESHOLD_X86
+
+namespace {
+    
+    // Per lane bounds for the 32-bit stage
+    struct Bounds32 {
+        int32_t s_lo, s_hi, h_lo, h_hi, wraps;
+    };
+    
+    __attribute__((target("sse4.1")))
+    inline void deinterleave16(const uchar* bgr, __m128i& b, __m128i& g, __m128i& r, const HSVTables& t) {
+        
+        __m128i chunk[3];
+        chunk[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr));
+        chunk[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr + 16));
+        chunk[2] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr + 32));
+        
+        __m128i* channels[3] = {&b, &g, &r};
+        
+        for (int c = 0; c < 3; ++c) {
+            __m128i value = _mm_setzero_si128();
+            for (int k = 0; k < 3; ++k) {
+                __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t.deinterleave[c][k]));
+                value = _mm_or_si128(value, _mm_shuffle_epi8(chunk[k], shuffle));
+            }
+            *channels[c] = value;
+        }
+    }
+    
+    // Lanes of v within [lo, hi], as 0xff/0x00 bytes
+    __attribute__((target("sse4.1")))
+    inline __m128i inRangeU8(__m128i v, __m128i lo, __m128i hi) {
+        
+        return _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, lo), v), 
+                             _mm_cmpeq_epi8(_mm_min_epu8(v, hi), v));
+    }
+    
+    /**
+     * H and S of four pixels held in the low bytes of each argument.
+     * sdiv and hdiv hold the table entries for v and diff.
+     */
+    __attribute__((target("sse4.1")))
+    inline void hsvSSE41(__m128i b8, __m128i g8, __m128i r8, __m128i v8, __m128i diff8,
+                         __m128i sdiv, __m128i hdiv, __m128i& h, __m128i& s) {
+        
+        const __m128i round = _mm_set1_epi32(HSV_ROUND);
+        
+        __m128i b = _mm_cvtepu8_epi32(b8);
+        __m128i g = _mm_cvtepu8_epi32(g8);
+        __m128i r = _mm_cvtepu8_epi32(r8);
+        __m128i v = _mm_cvtepu8_epi32(v8);
+        __m128i diff = _mm_cvtepu8_epi32(diff8);
+        
+        s = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(diff, sdiv), round), HSV_SHIFT);
+        
+        __m128i h_r = _mm_sub_epi32(g, b);
+        __m128i h_g = _mm_add_epi32(_mm_sub_epi32(b, r), _mm_slli_epi32(diff, 1));
+        __m128i h_b = _mm_add_epi32(_mm_sub_epi32(r, g), _mm_slli_epi32(diff, 2));
+        h = _mm_blendv_epi8(_mm_blendv_epi8(h_b, h_g, _mm_cmpeq_epi32(v, g)), h_r, _mm_cmpeq_epi32(v, r));
+        
+        h = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(h, hdiv), round), HSV_SHIFT);
+        h = _mm_add_epi32(h, _mm_and_si128(_mm_cmpgt_epi32(_mm_setzero_si128(), h), _mm_set1_epi32(HSV_HUE_RANGE)));
+    }
+    
+    // S and H tests of four pixels
+    __attribute__((target("sse4.1")))
+    inline __m128i passSSE41(__m128i h, __m128i s, const Bounds32& bounds) {
+        
+        __m128i s_pass = _mm_and_si128(_mm_cmpgt_epi32(s, _mm_set1_epi32(bounds.s_lo - 1)), 
+                                       _mm_cmpgt_epi32(_mm_set1_epi32(bounds.s_hi + 1), s));
+        
+        __m128i above_lo = _mm_cmpgt_epi32(h, _mm_set1_epi32(bounds.h_lo - 1));
+        __m128i below_hi = _mm_cmpgt_epi32(_mm_set1_epi32(bounds.h_hi + 1), h);
+        __m128i h_pass = _mm_or_si128(_mm_and_si128(above_lo, below_hi), 
+                                      _mm_and_si128(_mm_set1_epi32(bounds.wraps), _mm_or_si128(above_lo, below_hi)));
+        
+        return _mm_and_si128(s_pass, h_pass);
+    }
+    
+    // H and S of eight pixels held in the low bytes of each argument
+    __attribute__((target("avx2")))
+    inline void hsvAVX2(__m128i b8, __m128i g8, __m128i r8, __m128i v8, __m128i diff8,
+                        const HSVTables& t, __m256i& h, __m256i& s) {
+        
+        const __m256i round = _mm256_set1_epi32(HSV_ROUND);
+        
+        __m256i b = _mm256_cvtepu8_epi32(b8);
+        __m256i g = _mm256_cvtepu8_epi32(g8);
+        __m256i r = _mm256_cvtepu8_epi32(r8);
+        __m256i v = _mm256_cvtepu8_epi32(v8);
+        __m256i diff = _mm256_cvtepu8_epi32(diff8);
+        
+        __m256i sdiv = _mm256_i32gather_epi32(reinterpret_cast<const int*>(t.sdiv), v, 4);
+        __m256i hdiv = _mm256_i32gather_epi32(reinterpret_cast<const int*>(t.hdiv), diff, 4);
+        
+        s = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(diff, sdiv), round), HSV_SHIFT);
+        
+        __m256i h_r = _mm256_sub_epi32(g, b);
+        __m256i h_g = _mm256_add_epi32(_mm256_sub_epi32(b, r), _mm256_slli_epi32(diff, 1));
+        __m256i h_b = _mm256_add_epi32(_mm256_sub_epi32(r, g), _mm256_slli_epi32(diff, 2));
+        h = _mm256_blendv_epi8(_mm256_blendv_epi8(h_b, h_g, _mm256_cmpeq_epi32(v, g)), h_r, _mm256_cmpeq_epi32(v, r));
+        
+        h = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(h, hdiv), round), HSV_SHIFT);
+        h = _mm256_add_epi32(h, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), h), _mm256_set1_epi32(HSV_HUE_RANGE)));
+    }
+    
+    // S and H tests of eight pixels
+    __attribute__((target("avx2")))
+    inline __m256i passAVX2(__m256i h, __m256i s, const Bounds32& bounds) {
+        
+        __m256i s_pass = _mm256_and_si256(_mm256_cmpgt_epi32(s, _mm256_set1_epi32(bounds.s_lo - 1)), 
+                                          _mm256_cmpgt_epi32(_mm256_set1_epi32(bounds.s_hi + 1), s));
+        
+        __m256i above_lo = _mm256_cmpgt_epi32(h, _mm256_set1_epi32(bounds.h_lo - 1));
+        __m256i below_hi = _mm256_cmpgt_epi32(_mm256_set1_epi32(bounds.h_hi + 1), h);
+        __m256i h_pass = _mm256_or_si256(_mm256_and_si256(above_lo, below_hi), 
+                                         _mm256_and_si256(_mm256_set1_epi32(bounds.wraps), _mm256_or_si256(above_lo, below_hi)));
+        
+        return _mm256_and_si256(s_pass, h_pass);
+    }
+    
+    // Narrow eight 32-bit lane masks to 16-bit ones, in order
+    __attribute__((target("avx2")))
+    inline __m128i narrowAVX2(__m256i pass) {
+        
+        return _mm_packs_epi32(_mm256_castsi256_si128(pass), _mm256_extracti128_si256(pass, 1));
+    }
+}
+
+__attribute__((target("sse4.1")))
+void HSVThreshold::thresholdRowSSE41(const uchar* bgr, uchar* const* masks, 
+        const HSVThreshold* thresholds, int count, int width) {
+    
+    const HSVTables& t = tables();
+    
+    Bounds32 bounds[HSVTHRESHOLD_MAX_CLASSES];
+    __m128i v_lo8[HSVTHRESHOLD_MAX_CLASSES], v_hi8[HSVTHRESHOLD_MAX_CLASSES];
+    
+    for (int i = 0; i < count; ++i) {
+        const HSVThreshold& c = thresholds[i];
+        bounds[i] = {c.s_lo, c.s_hi, c.h_lo, c.h_hi, c.hue_wraps ? -1 : 0};
+        v_lo8[i] = _mm_set1_epi8(static_cast<char>(c.v_lo));
+        v_hi8[i] = _mm_set1_epi8(static_cast<char>(c.v_hi));
+    }
+    
+    alignas(16) uchar v_bytes[16];
+    alignas(16) uchar diff_bytes[16];
+    
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        
+        __m128i b, g, r;
+        deinterleave16(bgr + 3 * x, b, g, r, t);
+        
+        __m128i v = _mm_max_epu8(b, _mm_max_epu8(g, r));
+        __m128i diff = _mm_sub_epi8(v, _mm_min_epu8(b, _mm_min_epu8(g, r)));
+        
+        __m128i v_pass[HSVTHRESHOLD_MAX_CLASSES];
+        int v_any[HSVTHRESHOLD_MAX_CLASSES];
+        int any = 0;
+        
+        for (int i = 0; i < count; ++i) {
+            v_pass[i] = inRangeU8(v, v_lo8[i], v_hi8[i]);
+            v_any[i] = _mm_movemask_epi8(v_pass[i]);
+            any |= v_any[i];
+        }
+        
+        // Typically most of the frame is too dark or too bright
+        if (any == 0) {
+            for (int i = 0; i < count; ++i) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(masks[i] + x), _mm_setzero_si128());
+            }
+            continue;
+        }
+        
+        // There is no gather before AVX2
+        _mm_store_si128(reinterpret_cast<__m128i*>(v_bytes), v);
+        _mm_store_si128(reinterpret_cast<__m128i*>(diff_bytes), diff);
+        
+        __m128i h[4], s[4];
+        for (int k = 0; k < 4; ++k) {
+            
+            const uchar* vk = v_bytes + 4 * k;
+            const uchar* dk = diff_bytes + 4 * k;
+            __m128i sdiv = _mm_setr_epi32(t.sdiv[vk[0]], t.sdiv[vk[1]], t.sdiv[vk[2]], t.sdiv[vk[3]]);
+            __m128i hdiv = _mm_setr_epi32(t.hdiv[dk[0]], t.hdiv[dk[1]], t.hdiv[dk[2]], t.hdiv[dk[3]]);
+            
+            hsvSSE41(b, g, r, v, diff, sdiv, hdiv, h[k], s[k]);
+            
+            b = _mm_srli_si128(b, 4);
+            g = _mm_srli_si128(g, 4);
+            r = _mm_srli_si128(r, 4);
+            v = _mm_srli_si128(v, 4);
+            diff = _mm_srli_si128(diff, 4);
+        }
+        
+        for (int i = 0; i < count; ++i) {
+            
+            __m128i result = _mm_setzero_si128();
+            
+            if (v_any[i] != 0) {
+                result = _mm_packs_epi16(
+                        _mm_packs_epi32(passSSE41(h[0], s[0], bounds[i]), passSSE41(h[1], s[1], bounds[i])), 
+                        _mm_packs_epi32(passSSE41(h[2], s[2], bounds[i]), passSSE41(h[3], s[3], bounds[i])));
+                result = _mm_and_si128(result, v_pass[i]);
+            }
+            
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(masks[i] + x), result);
+        }
+    }
+    
+    thresholdRowScalar(bgr, masks, thresholds, count, x, width);
+}
+
+__attribute__((target("avx2")))
+void HSVThreshold::thresholdRowAVX2(const uchar* bgr, uchar* const* masks, 
+        const HSVThreshold* thresholds, int count, int width) {
+    
+    const HSVTables& t = tables();
+    
+    Bounds32 bounds[HSVTHRESHOLD_MAX_CLASSES];
+    __m128i v_lo8[HSVTHRESHOLD_MAX_CLASSES], v_hi8[HSVTHRESHOLD_MAX_CLASSES];
+    
+    for (int i = 0; i < count; ++i) {
+        const HSVThreshold& c = thresholds[i];
+        bounds[i] = {c.s_lo, c.s_hi, c.h_lo, c.h_hi, c.hue_wraps ? -1 : 0};
+        v_lo8[i] = _mm_set1_epi8(static_cast<char>(c.v_lo));
+        v_hi8[i] = _mm_set1_epi8(static_cast<char>(c.v_hi));
+    }
+    
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        
+        __m128i b, g, r;
+        deinterleave16(bgr + 3 * x, b, g, r, t);
+        
+        __m128i v = _mm_max_epu8(b, _mm_max_epu8(g, r));
+        __m128i diff = _mm_sub_epi8(v, _mm_min_epu8(b, _mm_min_epu8(g, r)));
+        
+        __m128i v_pass[HSVTHRESHOLD_MAX_CLASSES];
+        int v_any[HSVTHRESHOLD_MAX_CLASSES];
+        int any = 0;
+        
+        for (int i = 0; i < count; ++i) {
+            v_pass[i] = inRangeU8(v, v_lo8[i], v_hi8[i]);
+            v_any[i] = _mm_movemask_epi8(v_pass[i]);
+            any |= v_any[i];
+        }
+        
+        if (any == 0) {
+            for (int i = 0; i < count; ++i) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(masks[i] + x), _mm_setzero_si128());
+            }
+            continue;
+        }
+        
+        __m256i h_lo, s_lo, h_hi, s_hi;
+        hsvAVX2(b, g, r, v, diff, t, h_lo, s_lo);
+        hsvAVX2(_mm_srli_si128(b, 8), _mm_srli_si128(g, 8), _mm_srli_si128(r, 8), 
+                _mm_srli_si128(v, 8), _mm_srli_si128(diff, 8), t, h_hi, s_hi);
+        
+        for (int i = 0; i < count; ++i) {
+            
+            __m128i result = _mm_setzero_si128();
+            
+            if (v_any[i] != 0) {
+                result = _mm_packs_epi16(narrowAVX2(passAVX2(h_lo, s_lo, bounds[i])), 
+                                         narrowAVX2(passAVX2(h_hi, s_hi, bounds[i])));
+                result = _mm_and_si128(result, v_pass[i]);
+            }
+            
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(masks[i] + x), result);
+        }
+    }
+    
+    thresholdRowScalar(bgr, masks, thresholds, count, x, width);
+}
+
+#else
+
+// Never selected on other architectures
+void HSVThreshold::thresholdRowSSE41(const uchar* bgr, uchar* const* masks, 
+        const HSVThreshold* thresholds, int count, int width) {
+    thresholdRowScalar(bgr, masks, thresholds, count, 0, width);
+}
+
+void HSVThreshold::thresholdRowAVX2(const uchar* bgr, uchar* const* masks, 
+        const HSVThreshold* thresholds, int count, int width) {
+    thresholdRowScalar(bgr, masks, thresholds, count, 0, width);
+}
+
+#endif
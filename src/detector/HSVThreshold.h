@@ -0,0 +1,98 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef HSVTHRESHOLD_H
+#define	HSVTHRESHOLD_H
+
+#include <string>
+#include <opencv2/core/mat.hpp>
+
+// Most bounds that one pass can test
+#define HSVTHRESHOLD_MAX_CLASSES 8
+
+/**
+ * Single pass HSV threshold of an 8-bit BGR image. Each pixel is converted 
+ * to HSV with the same integer arithmetic as cv::cvtColor(COLOR_BGR2HSV) and
+ * tested against the bounds without the HSV image ever being written, so the
+ * mask matches cvtColor followed by cv::inRange bit for bit. Uses AVX2 or 
+ * SSE4.1 when the CPU has them.
+ * 
+ * Bounds are inclusive and, like cv::inRange's, saturated to [0, 255]. A hue 
+ * range whose minimum is above its maximum wraps around through zero, e.g. 
+ * h_min = 170, h_max = 10 for red.
+ */
+class HSVThreshold {
+public:
+    
+    enum class Kernel {
+        SCALAR,
+        SSE41,
+        AVX2
+    };
+    
+    HSVThreshold(void);
+    
+    void set_bounds(int h_min, int h_max, int s_min, int s_max, int v_min, int v_max);
+    
+    // Same bounds once saturated
+    bool operator==(const HSVThreshold& other) const;
+    bool operator!=(const HSVThreshold& other) const { return !(*this == other); }
+    
+    /**
+     * Write a CV_8UC1 mask that is 255 where the BGR pixel is within bounds
+     * and 0 elsewhere.
+     */
+    void apply(const cv::Mat& bgr, cv::Mat& mask) const;
+    
+    // Use a particular kernel, or the scalar one if the CPU lacks it
+    void apply(const cv::Mat& bgr, cv::Mat& mask, Kernel kernel) const;
+    
+    /**
+     * Threshold against several sets of bounds while converting each pixel
+     * only once. masks[i] receives the mask of thresholds[i]. At most 
+     * HSVTHRESHOLD_MAX_CLASSES sets may be given.
+     */
+    static void apply(const cv::Mat& bgr, const HSVThreshold* thresholds, 
+                      cv::Mat* masks, int count);
+    static void apply(const cv::Mat& bgr, const HSVThreshold* thresholds, 
+                      cv::Mat* masks, int count, Kernel kernel);
+    
+    // The cvtColor and inRange passes this replaces. For checking and timing.
+    void applyReference(const cv::Mat& bgr, cv::Mat& mask) const;
+    
+    // Fastest kernel this CPU supports
+    static Kernel bestKernel(void);
+    static bool isSupported(Kernel kernel);
+    static std::string kernelName(Kernel kernel);
+    
+private:
+    
+    // Saturated bounds
+    int h_lo, h_hi, s_lo, s_hi, v_lo, v_hi;
+    bool hue_wraps;
+    
+    bool passes(int h, int s) const;
+    
+    // Threshold pixels [begin, width) of a row against count sets of bounds
+    static void thresholdRowScalar(const uchar* bgr, uchar* const* masks, 
+            const HSVThreshold* thresholds, int count, int begin, int width);
+    static void thresholdRowSSE41(const uchar* bgr, uchar* const* masks, 
+            const HSVThreshold* thresholds, int count, int width);
+    static void thresholdRowAVX2(const uchar* bgr, uchar* const* masks, 
+            const HSVThreshold* thresholds, int count, int width);
+};
+
+#endif	/* HSVTHRESHOLD_H */
@@ -0,0 +1,320 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "MultiHSVDetector.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "../../lib/cpptoml/cpptoml.h"
+
+MultiHSVDetector::MarkerClass::MarkerClass(std::string class_name, std::string sink_name) :
+  name(class_name)
+, sliders(parameters, nullptr)
+, min_object_area(0)
+, max_object_area(0)
+, object_area(0)
+, position_sink(sink_name) { }
+
+MultiHSVDetector::MultiHSVDetector(std::string image_source_name, std::string position_sink_name) :
+Detector(image_source_name, position_sink_name, false)
+, lut_on(false)
+, sink_prefix(position_sink_name) { }
+
+void MultiHSVDetector::stop() {
+    
+    for (auto& marker : classes) {
+        marker->position_sink.set_running(false);
+    }
+}
+
+void MultiHSVDetector::findObjectAndServePosition() {
+
+    // If we are able to get a an image
+    if (image_source.getSharedMat(frame)) {
+
+        int64_t enter_ns = shmem::Sample::nowInNs();
+        
+        for (auto& marker : classes) {
+            marker->object_position.sample = image_source.get_sample();
+        }
+        
+        addWorldReferenceFrame();
+        applyThreshold();
+        clarifyBlobs();
+        siftBlobs();
+        tune();
+
+        for (auto& marker : classes) {
+            marker->object_position.sample.addStage(marker->position_sink.get_stage(), enter_ns);
+            marker->position_sink.pushObject(marker->object_position);
+        }
+    }
+}
+
+void MultiHSVDetector::applyThreshold() {
+    
+    // Bounds are reapplied every frame because the tuning sliders change 
+    // them
+    for (size_t i = 0; i < classes.size(); ++i) {
+        classes[i]->parameters.applyBounds(thresholds[i]);
+    }
+    
+    int count = static_cast<int>(classes.size());
+    
+    if (lut_on) {
+        color_lut.update(thresholds, count);
+    }
+    
+    for (int i = 0; i < count; ++i) {
+        threshold_images[i].create(frame.size(), CV_8UC1);
+    }
+    
+    forEachBand(frame.rows, [&](int, const cv::Range& rows) {
+        
+        cv::Mat masks[HSVTHRESHOLD_MAX_CLASSES];
+        for (int i = 0; i < count; ++i) {
+            masks[i] = threshold_images[i].rowRange(rows);
+        }
+        
+        if (lut_on) {
+            color_lut.apply(frame.rowRange(rows), masks);
+        } else {
+            HSVThreshold::apply(frame.rowRange(rows), thresholds, masks, count);
+        }
+    });
+}
+
+void MultiHSVDetector::clarifyBlobs() {
+
+    for (size_t i = 0; i < classes.size(); ++i) {
+        
+        const HSVParameters& p = classes[i]->parameters;
+        
+        clarify(threshold_images[i], clarify_images[i], 
+                p.erode_on, p.erode_element, 
+                p.dilate_on, p.dilate_element);
+    }
+}
+
+void MultiHSVDetector::siftBlobs() {
+    
+    for (size_t i = 0; i < classes.size(); ++i) {
+        
+        MarkerClass& marker = *classes[i];
+        cv::Mat& threshold_image = threshold_images[i];
+        
+        findBlobs(threshold_image);
+        const Blob* object = blob_finder.largest(marker.min_object_area, marker.max_object_area);
+        
+        if (object != nullptr) {
+            cv::Point2f centroid = object->centroid();
+            marker.object_position.position.x = centroid.x;
+            marker.object_position.position.y = centroid.y;
+            marker.object_position.position_valid = true;
+            marker.object_area = static_cast<double>(object->area);
+        } else {
+            marker.object_position.position_valid = false;
+            marker.object_area = 0;
+        }
+        
+        if (tuning_on) {
+
+            std::string msg;
+            int baseline = 0;
+            cv::Size textSize = cv::getTextSize(msg, 1, 1, 1, &baseline);
+            cv::Point text_origin(
+                    threshold_image.cols - 2 * textSize.width - 10,
+                    threshold_image.rows - 2 * baseline - 10);
+
+            // Plot a circle representing found object
+            if (marker.object_position.position_valid) {
+                auto radius = std::sqrt(marker.object_area / CV_PI);
+                cv::Point center;
+                center.x = marker.object_position.position.x;
+                center.y = marker.object_position.position.y;
+                cv::circle(threshold_image, center, radius, cv::Scalar(0, 0, 255), 2);
+                
+                msg = cv::format("%s (%d, %d) pixels", marker.name.c_str(), 
+                        (int) marker.object_position.position.x, (int) marker.object_position.position.y);
+            } else {
+                msg = marker.name + " not found";
+            }
+            
+            cv::putText(threshold_image, msg, text_origin, 1, 1, cv::Scalar(0, 255, 0));
+        }
+    }
+}
+
+void MultiHSVDetector::addWorldReferenceFrame() {
+
+    if (image_source.get_world_coords_valid()) {
+        
+        for (auto& marker : classes) {
+            
+            marker->object_position.world_coords_valid = true;
+
+            marker->object_position.xyz_origin_in_px.x = image_source.get_xy_origin_in_px().x;
+            marker->object_position.xyz_origin_in_px.y = image_source.get_xy_origin_in_px().y;
+
+            marker->object_position.worldunits_per_px_x = image_source.get_worldunits_per_px_x();
+            marker->object_position.worldunits_per_px_y = image_source.get_worldunits_per_px_y();
+        }
+    }
+}
+
+void MultiHSVDetector::configure(std::string file_name, std::string key) {
+
+    cpptoml::table config;
+
+    try {
+        config = cpptoml::parse_file(file_name);
+    } catch (const cpptoml::parse_exception& e) {
+        std::cerr << "Failed to parse " << file_name << ": " << e.what() << std::endl;
+    }
+
+    try {
+        // See if a camera configuration was provided
+        if (config.contains(key)) {
+
+            auto this_config = *config.get_table(key);
+            
+            // Defaults for every class
+            HSVParameters defaults;
+            defaults.set_dilate_size(10);
+            defaults.configure(this_config);
+            
+            configureObjectArea(this_config);
+            configureThreads(this_config);
+            
+            if (this_config.contains("lut_bits")) {
+                lut_on = true;
+                color_lut.set_bits((int) (*this_config.get_as<int64_t>("lut_bits")));
+            }
+            
+            if (this_config.contains("classes")) {
+                for (auto& class_config : this_config.get_table_array("classes")->get()) {
+                    addClass(*class_config, defaults);
+                }
+            }
+            
+            if (classes.empty()) {
+                std::cerr << "MultiHSVDetector configuration \"" + key + "\" lists no classes. Exiting." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            if (this_config.contains("tune")) {
+                if (*this_config.get_as<bool>("tune")) {
+                    tuning_on = true;
+                    createTuningWindows();
+                }
+            }
+
+        } else {
+            std::cerr << "No MultiHSVDetector configuration named \"" + key + "\" was provided. Exiting." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void MultiHSVDetector::addClass(cpptoml::table& class_config, const HSVParameters& defaults) {
+    
+    if (classes.size() == HSVTHRESHOLD_MAX_CLASSES) {
+        std::cerr << "A MultiHSVDetector can detect at most " << HSVTHRESHOLD_MAX_CLASSES << " classes. Exiting." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    
+    if (!class_config.contains("name")) {
+        std::cerr << "Each MultiHSVDetector class needs a name. Exiting." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    
+    std::string name = *class_config.get_as<std::string>("name");
+    std::string sink_name = sink_prefix + "_" + name;
+    
+    if (class_config.contains("sink")) {
+        sink_name = *class_config.get_as<std::string>("sink");
+    }
+    
+    std::unique_ptr<MarkerClass> marker(new MarkerClass(name, sink_name));
+    
+    marker->parameters = defaults;
+    marker->parameters.configure(class_config);
+    
+    marker->min_object_area = min_object_area;
+    marker->max_object_area = max_object_area;
+    
+    if (class_config.contains("object_area")) {
+        auto t = *class_config.get_table("object_area");
+
+        if (t.contains("min")) {
+            marker->min_object_area = (double) (*t.get_as<int64_t>("min"));
+        }
+        if (t.contains("max")) {
+            marker->max_object_area = (double) (*t.get_as<int64_t>("max"));
+        }
+    }
+    
+    if (class_config.contains("buffer_depth")) {
+        marker->position_sink.set_buffer_depth((size_t) (*class_config.get_as<int64_t>("buffer_depth")));
+    }
+
+    shmem::OverflowPolicy policy;
+    if (shmem::parseOverflowPolicy(class_config, policy)) {
+        marker->position_sink.set_overflow_policy(policy);
+    }
+    
+    classes.push_back(std::move(marker));
+}
+
+void MultiHSVDetector::tune() {
+
+    if (tuning_on) {
+        if (!tuning_windows_created) {
+            createTuningWindows();
+        }
+        for (size_t i = 0; i < classes.size(); ++i) {
+            cv::imshow(tuning_image_title + "_" + classes[i]->name, threshold_images[i]);
+        }
+        cv::waitKey(1);
+    } else if (!tuning_on && tuning_windows_created) {
+        // Destroy the tuning windows
+        for (auto& marker : classes) {
+            cv::destroyWindow(tuning_image_title + "_" + marker->name);
+            cv::destroyWindow(slider_title + "_" + marker->name);
+        }
+        tuning_windows_created = false;
+    }
+}
+
+void MultiHSVDetector::createTuningWindows() {
+    
+    for (auto& marker : classes) {
+        
+        // Create window for sliders
+        std::string sliders = slider_title + "_" + marker->name;
+        cv::namedWindow(sliders, cv::WINDOW_AUTOSIZE);
+
+        // Create sliders and insert them into window
+        marker->sliders.create(sliders);
+    }
+
+    tuning_windows_created = true;
+}
@@ -0,0 +1,113 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef MULTIHSVDETECTOR_H
+#define	MULTIHSVDETECTOR_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+
+#include "Detector.h"
+#include "ColorLUT.h"
+#include "HSVParameters.h"
+#include "HSVThreshold.h"
+
+/**
+ * Detects several differently coloured objects, e.g. the LEDs of a head 
+ * direction rig, in the same image stream. Each frame is converted and 
+ * thresholded against every class in a single pass, and each class publishes
+ * its own position SINK. Classes are listed in the configuration file.
+ * 
+ * Every frame is searched whole: the classes share one conversion pass, so 
+ * there is no single window to search.
+ * @param image_source_name Image SOURCE name
+ * @param position_sink_name Prefix of the position SINK names
+ */
+class MultiHSVDetector : public Detector {
+    
+public:
+    
+    MultiHSVDetector(std::string image_source_name, std::string position_sink_name);
+
+    // Use a configuration file to specify parameters. The file must list at
+    // least one class.
+    void configure(std::string file_name, std::string key);
+    
+    // Threshold the next frame for every class and serve each class' position
+    void findObjectAndServePosition(void);
+    
+    void stop(void);
+    
+private:
+    
+    // One colour to be detected
+    struct MarkerClass {
+        
+        MarkerClass(std::string class_name, std::string sink_name);
+        
+        const std::string name;
+        
+        // HSV thresholds and erode/dilate sizes. Tuned on the detection 
+        // thread, so the sliders need no lock.
+        HSVParameters parameters;
+        HSVSliders sliders;
+        
+        double min_object_area, max_object_area;
+        
+        // Object detection
+        double object_area;
+        shmem::Position object_position;
+        shmem::SMServer<shmem::Position> position_sink;
+    };
+    
+    // Held by pointer so the tuning sliders can bind to their members
+    std::vector< std::unique_ptr<MarkerClass> > classes;
+    
+    // Kept side by side for HSVThreshold. Element i belongs to classes[i].
+    HSVThreshold thresholds[HSVTHRESHOLD_MAX_CLASSES];
+    cv::Mat threshold_images[HSVTHRESHOLD_MAX_CLASSES];
+    cv::Mat clarify_images[HSVTHRESHOLD_MAX_CLASSES]; // Swapped in when threaded
+    
+    // Classify by table lookup rather than conversion
+    bool lut_on;
+    ColorLUT color_lut;
+    
+    cv::Mat frame;
+    const std::string sink_prefix;
+    
+    // Read one class from its table, using the detector wide values as 
+    // defaults
+    void addClass(cpptoml::table& class_config, const HSVParameters& defaults);
+    
+    void addWorldReferenceFrame(void);
+    
+    // Binary threshold of the frame for every class, in one pass
+    void applyThreshold(void);
+    
+    // Erode/dilate objects to get rid of speckles
+    void clarifyBlobs(void);
+    
+    // Pull the largest blob of each class out of its threshold image
+    void siftBlobs(void);
+    
+    // Sliders to allow manipulation of each class' HSV thresholds
+    void tune(void);
+    void createTuningWindows(void);
+};
+
+#endif	/* MULTIHSVDETECTOR_H */
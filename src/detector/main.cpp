@@ -17,6 +17,7 @@
 #include "Detector.h"
 #include "HSVDetector.h"
 #include "DifferenceDetector.h"
+#include "MultiHSVDetector.h"
 
 
 #include <signal.h>
@@ -42,7 +43,9 @@ void printUsage(po::options_description options) {
     std::cout << "Publish detected object positions to a SMSserver<Position2D> SINK.\n\n";
     std::cout << "TYPE\n";
     std::cout << "  diff: Difference detector (grey-scale)\n";
-    std::cout << "  hsv: HSV detector (color)\n\n";
+    std::cout << "  hsv: HSV detector (color)\n";
+    std::cout << "  multi_hsv: HSV detector for several colors at once. Each color\n";
+    std::cout << "    is served to SINK_<name> (requires a CONFIGURATION)\n\n";
     std::cout << options << "\n";
 }
 
@@ -75,6 +78,7 @@ int main(int argc, char *argv[]) {
     std::unordered_map<std::string, char> type_hash;
     type_hash["diff"] = 'a';
     type_hash["hsv"] = 'b';
+    type_hash["multi_hsv"] = 'c';
 
     try {
 
@@ -94,7 +98,8 @@ int main(int argc, char *argv[]) {
                 ("type,t", po::value<std::string>(&type), "Detector type.\n\n"
                 "Values:\n"
                 "  diff: Difference detector (grey-scale)\n"
-                "  hsv: HSV detector (color)")
+                "  hsv: HSV detector (color)\n"
+                "  multi_hsv: HSV detector for several colors at once")
                 ("source", po::value<std::string>(&source),
                 "The name of the SOURCE that supplies images on which hsv-filter object detection will be performed."
                 "The server must be of type SMServer<SharedCVMatHeader>\n")
@@ -182,6 +187,16 @@ int main(int argc, char *argv[]) {
             detector = new HSVDetector(source, sink);
             break;
         }
+        case 'c':
+        {
+            if (!config_used) {
+                printUsage(options);
+                std::cout << "Error: a multi_hsv detector reads its colors from a CONFIGURATION. Exiting.\n";
+                return -1;
+            }
+            detector = new MultiHSVDetector(source, sink);
+            break;
+        }
         default:
         {
             printUsage(options);
@@ -50,11 +50,38 @@ void PositionCombiner::combineAndServePosition() {
             }
 
             // Fall through
+            current_processing_stage = 2;
+
+        case 2:
+
+            // Join on sample number. If one source is behind, because it 
+            // started late or dropped a sample, read it again until the two
+            // line up. Sources that do not stamp their samples leave the
+            // number at 0 and can never line up, so those are just paired.
+            while (anterior.sample.number != 0 && posterior.sample.number != 0 &&
+                   anterior.sample.number != posterior.sample.number) {
+
+                if (anterior.sample.number < posterior.sample.number) {
+                    if (!anterior_source.getSharedObject(anterior)) {
+                        return;
+                    }
+                } else {
+                    if (!posterior_source.getSharedObject(posterior)) {
+                        return;
+                    }
+                }
+            }
+
             current_processing_stage = 0;
     }
 
+    // Both inputs are in hand
+    int64_t enter_ns = shmem::Sample::nowInNs();
+    
+    processed_position.sample = anterior.sample;
     calculateGeometricMean();
 
+    processed_position.sample.addStage(position_sink.get_stage(), enter_ns);
     position_sink.pushObject(processed_position);
 }
 
@@ -32,6 +32,7 @@ PositionFilter(position_source_name, position_sink_name)
 , kf_predicted_state(6, 1, CV_32F)
 , kf_meas(3, 1, CV_32F)
 , found(false)
+, not_found_count(0)
 , not_found_count_threshold(100) // TODO: good idea?
 , sig_accel(5.0)
 , sig_measure_noise(5.0)
@@ -44,29 +45,35 @@ PositionFilter(position_source_name, position_sink_name)
 
 bool KalmanFilter::grabPosition() {
 
-    if (position_source.getSharedObject(raw_position)) {
+    if (position_source->getSharedObject(raw_position)) {
 
-        // Transform raw position into kf_meas vector
-        if (raw_position.position_valid) {
-            kf_meas.at<float>(0) = raw_position.position.x;
-            kf_meas.at<float>(1) = raw_position.position.y;
-            kf_meas.at<float>(2) = raw_position.position.z;
-            not_found_count = 0;
+        measure();
+        return true;
+    } else {
+        return false;
+    }
+}
 
-            // We are coming from a time step where there were no measurements for a
-            // long time, so we need to reinitialize the filter
-            if (!found) {
-                initializeFilter();
-            }
+void KalmanFilter::measure() {
 
-            found = true;
-        } else {
-            not_found_count++;
+    filtered_position.sample = raw_position.sample;
+
+    // Transform raw position into kf_meas vector
+    if (raw_position.position_valid) {
+        kf_meas.at<float>(0) = raw_position.position.x;
+        kf_meas.at<float>(1) = raw_position.position.y;
+        kf_meas.at<float>(2) = raw_position.position.z;
+        not_found_count = 0;
+
+        // We are coming from a time step where there were no measurements for a
+        // long time, so we need to reinitialize the filter
+        if (!found) {
+            initializeFilter();
         }
 
-        return true;
+        found = true;
     } else {
-        return false;
+        not_found_count++;
     }
 }
 
@@ -91,6 +98,18 @@ void KalmanFilter::filterPosition() {
 
 void KalmanFilter::serveFilteredPosition() {
 
+    updateFilteredPosition();
+
+    // Tune the filter, if requested
+    tune();
+
+    // Publish filtered position
+    filtered_position.sample.addStage(position_sink.get_stage(), enter_ns);
+    position_sink.pushObject(filtered_position);
+}
+
+void KalmanFilter::updateFilteredPosition() {
+
     // Create a new Position object from the kf_state
     filtered_position.position.x = kf_predicted_state.at<float>(0);
     filtered_position.velocity.x = kf_predicted_state.at<float>(1);
@@ -108,12 +127,28 @@ void KalmanFilter::serveFilteredPosition() {
         filtered_position.position_valid = false;
         filtered_position.velocity_valid = false;
     }
+}
 
-    // Tune the filter, if requested
-    tune();
+void KalmanFilter::reset(float dt, float sig_accel, float sig_measure_noise, int not_found_count_threshold) {
 
-    // Publish filtered position
-    position_sink.pushObject(filtered_position);
+    this->dt = dt;
+    this->sig_accel = sig_accel;
+    this->sig_measure_noise = sig_measure_noise;
+    this->not_found_count_threshold = not_found_count_threshold;
+    
+    // The next valid measurement reinitializes the filter
+    found = false;
+    not_found_count = 0;
+}
+
+const shmem::Position& KalmanFilter::filterMeasurement(const shmem::Position& measurement) {
+
+    raw_position = measurement;
+    measure();
+    filterPosition();
+    updateFilteredPosition();
+    
+    return filtered_position;
 }
 
 void KalmanFilter::configure(std::string config_file, std::string config_key) {
@@ -132,6 +167,8 @@ void KalmanFilter::configure(std::string config_file, std::string config_key) {
 
             auto this_config = *config.get_table(config_key);
 
+            configureTransport(this_config);
+
             if (this_config.contains("dt")) {
                 dt = (float) (*this_config.get_as<double>("dt"));
             }
@@ -150,6 +187,15 @@ void KalmanFilter::configure(std::string config_file, std::string config_key) {
                 sig_measure_noise = (float) (*this_config.get_as<double>("sigma_noise"));
             }
 
+            if (this_config.contains("buffer_depth")) {
+                position_sink.set_buffer_depth((size_t) (*this_config.get_as<int64_t>("buffer_depth")));
+            }
+            
+            shmem::OverflowPolicy policy;
+            if (shmem::parseOverflowPolicy(this_config, policy)) {
+                position_sink.set_overflow_policy(policy);
+            }
+            
             if (this_config.contains("tune")) {
                 if (*this_config.get_as<bool>("tune")) {
                     tuning_on = true;
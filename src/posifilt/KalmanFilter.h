@@ -37,8 +37,15 @@ public:
      * configure the Kalman filter.
      */
     void configure(std::string config_file, std::string config_key);
+    
+    // Set the model parameters and forget the current track
+    void reset(float dt, float sig_accel, float sig_measure_noise, int not_found_count_threshold);
+    
+    // Filter one measurement directly, without shared memory or tuning
+    const shmem::Position& filterMeasurement(const shmem::Position& measurement);
 
 private:
+    
     // Kalman state estimate and measurement vectors
     cv::Mat kf_predicted_state, kf_meas;
 
@@ -63,6 +70,8 @@ private:
     int not_found_count_threshold;
 
     cv::KalmanFilter kf;
+    void measure(void);                // raw_position -> kf_meas
+    void updateFilteredPosition(void); // kf state -> filtered_position
     void tune(void);
     void initializeFilter(void);
     void initializeStaticMatracies(void);
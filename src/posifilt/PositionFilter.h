@@ -17,10 +17,13 @@
 #define	POSITIONFILTER_H
 
 #include <atomic>
+#include <memory>
 #include <boost/thread/mutex.hpp>
 
+#include "../../lib/shmem/LatencyProfile.h"
 #include "../../lib/shmem/SMServer.h"
 #include "../../lib/shmem/SMClient.h"
+#include "../../lib/shmem/Transport.h"
 #include "../../lib/shmem/Position.h"
 
 
@@ -29,25 +32,39 @@ public:
 
     PositionFilter(std::string position_source_name, std::string position_sink_name) :
     name(position_sink_name)
-    , position_source(position_source_name)
+    , position_source(new shmem::SMClient<shmem::Position>(position_source_name))
+    , position_source_found(false)
     , position_sink(position_sink_name)
     , canvas_hw(500.0)
     , canvas_border(100.0)
+    , enter_ns(0)
     , tuning_image_title(position_sink_name + "_tuning")
-    , slider_title(position_sink_name + "_sliders") {
-
-        position_source.findSharedObject();
-    }
+    , slider_title(position_sink_name + "_sliders") { }
+    
+    // Filters are deleted through this class
+    virtual ~PositionFilter() { }
 
     // Execute filtering operation
 
     void filterPositionAndServe(void) {
 
+        // Found on first use so that configure can choose the transport
+        if (!position_source_found) {
+            position_source->findSharedObject();
+            position_source_found = true;
+        }
+
         if (grabPosition()) {
+            enter_ns = shmem::Sample::nowInNs();
             filterPosition();
             serveFilteredPosition();
+            latency.record(filtered_position.sample, shmem::Sample::nowInNs());
         }
     }
+    
+    // Latency of each stage upstream of this filter, including its own
+    void printLatency(void) { latency.print(std::cout, name); }
+    void resetLatency(void) { latency.reset(); }
 
     // Position filters must be configurable via file
     virtual void configure(std::string config_file, std::string config_key) = 0;
@@ -74,10 +91,27 @@ protected:
     const float canvas_border;
 
     std::string name;
-    shmem::SMClient<shmem::Position> position_source;
+    std::unique_ptr<shmem::ObjectClient<shmem::Position> > position_source;
+    bool position_source_found;
     shmem::Position raw_position;
     shmem::SMServer<shmem::Position> position_sink;
     shmem::Position filtered_position;
+    
+    // When the current raw position was obtained. serveFilteredPosition must 
+    // add a stage stamp starting at this time before pushing.
+    int64_t enter_ns;
+    shmem::LatencyProfile latency;
+
+    // Read an optional transport key and replace position_source with a 
+    // client of that transport. It must match the transport of the source.
+    void configureTransport(cpptoml::table& config) {
+        
+        shmem::Transport transport;
+        if (!position_source_found && shmem::parseTransport(config, transport)) {
+            std::string source_name = position_source->get_name();
+            position_source.reset(shmem::makeClient<shmem::Position>(transport, source_name));
+        }
+    }
 
     // tuning on or off
     std::string tuning_image_title, slider_title;
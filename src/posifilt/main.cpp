@@ -167,6 +167,8 @@ int main(int argc, char *argv[]) {
     std::cout << "COMMANDS:\n";
     std::cout << "  t: Enable tuning mode.\n";
     std::cout << "  T: Disable tuning mode.\n";
+    std::cout << "  l: Print latency histograms.\n";
+    std::cout << "  L: Reset latency histograms.\n";
     std::cout << "  x: Exit.\n";
 
     // Two threads - one for user interaction, the other
@@ -192,6 +194,16 @@ int main(int argc, char *argv[]) {
                 position_filter->set_tune_mode(false);
                 break;
             }
+            case 'l':
+            {
+                position_filter->printLatency();
+                break;
+            }
+            case 'L':
+            {
+                position_filter->resetLatency();
+                break;
+            }
             case 'x':
             {
                 done = true;
@@ -0,0 +1,115 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "StatsMonitor.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+
+StatsMonitor::StatsMonitor() :
+  attached(false) {
+    
+    for (int i = 0; i < SHMEM_MAX_STATS_STREAMS; ++i) {
+        previous[i].pid = 0;
+    }
+}
+
+bool StatsMonitor::attach() {
+    
+    attached = segment.attach();
+    return attached;
+}
+
+void StatsMonitor::print(std::ostream& out) {
+    
+    if (!attached && !attach()) {
+        out << "No servers are running.\n";
+        return;
+    }
+    
+    int64_t now = shmem::Sample::nowInNs();
+    shmem::StatsTable* table = segment.get_table();
+    
+    std::ios::fmtflags flags = out.flags();
+    
+    out << std::left << std::setw(20) << "STREAM" << std::setw(11) << "TYPE" 
+        << std::right << std::setw(8) << "PID" << std::setw(10) << "PUSH/s" 
+        << std::setw(10) << "PUB/s" << std::setw(10) << "DROPS" << std::setw(8) << "DROP/s"
+        << std::setw(8) << "BUFFER" << std::setw(9) << "CLIENTS" << std::setw(9) << "WAIT %" << "\n";
+    
+    for (int i = 0; i < SHMEM_MAX_STATS_STREAMS; ++i) {
+        
+        shmem::StreamStats& stats = table->streams[i];
+        
+        if (stats.state != 2 || !shmem::StatsSegment::isAlive(stats.pid)) {
+            continue;
+        }
+        
+        Snapshot current = {stats.pid, stats.pushed, stats.published, stats.dropped, stats.barrier_wait_ns, now};
+        Snapshot& last = previous[i];
+        
+        // Rates need a previous snapshot of the same server
+        double seconds = (now - last.time_ns) / 1e9;
+        bool have_rates = last.pid == current.pid && seconds > 0;
+        
+        out << std::left << std::setw(20) << stats.name << std::setw(11) << stats.kind
+            << std::right << std::setw(8) << stats.pid;
+        
+        if (have_rates) {
+            out << std::fixed << std::setprecision(1)
+                << std::setw(10) << (current.pushed - last.pushed) / seconds
+                << std::setw(10) << (current.published - last.published) / seconds;
+        } else {
+            out << std::setw(10) << "-" << std::setw(10) << "-";
+        }
+        
+        out << std::setw(10) << current.dropped;
+        
+        if (have_rates) {
+            out << std::setw(8) << (current.dropped - last.dropped) / seconds;
+        } else {
+            out << std::setw(8) << "-";
+        }
+        
+        std::string buffer = std::to_string(stats.buffer_occupancy) + "/" + std::to_string(stats.buffer_depth);
+        std::string clients = std::to_string(stats.number_of_clients) + "+" + std::to_string(stats.number_of_latest_only_clients);
+        out << std::setw(8) << buffer << std::setw(9) << clients;
+        
+        // Share of wall time the server thread spent waiting on clients
+        if (have_rates) {
+            out << std::setw(9) << 100.0 * (current.barrier_wait_ns - last.barrier_wait_ns) / (seconds * 1e9);
+        } else {
+            out << std::setw(9) << "-";
+        }
+        
+        out << "\n";
+        
+        // Read lag of each client, in publications
+        uint32_t number_of_clients = std::min<uint32_t>(stats.number_of_client_stats, SHMEM_MAX_CLIENTS);
+        for (uint32_t c = 0; c < number_of_clients; ++c) {
+            
+            const shmem::ClientStats& client = stats.clients[c];
+            out << "    client " << std::setw(8) << client.pid 
+                << (client.lossless ? "  lossless     " : "  latest only  ") 
+                << "lag " << client.lag << "\n";
+        }
+        
+        last = current;
+    }
+    
+    out.flags(flags);
+}
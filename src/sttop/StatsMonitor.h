@@ -0,0 +1,53 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef STATSMONITOR_H
+#define	STATSMONITOR_H
+
+#include <iostream>
+
+#include "../../lib/shmem/StreamStats.h"
+
+/**
+ * Reads the stats segment shared by all servers and prints one line per 
+ * running stream, with rates computed since the previous print.
+ */
+class StatsMonitor {
+public:
+    
+    StatsMonitor(void);
+    
+    // Attach to the stats segment. False if no server has created it yet.
+    bool attach(void);
+    
+    void print(std::ostream& out);
+    
+private:
+    
+    shmem::StatsSegment segment;
+    bool attached;
+    
+    // Counters seen at the previous print, for computing rates
+    struct Snapshot {
+        int32_t pid;
+        uint64_t pushed, published, dropped, barrier_wait_ns;
+        int64_t time_ns;
+    };
+    
+    Snapshot previous[SHMEM_MAX_STATS_STREAMS];
+};
+
+#endif	/* STATSMONITOR_H */
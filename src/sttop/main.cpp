@@ -0,0 +1,105 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "StatsMonitor.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <signal.h>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+volatile sig_atomic_t done = 0;
+
+void term(int) {
+    done = 1;
+}
+
+void printUsage(po::options_description options) {
+    std::cout << "Usage: sttop [OPTIONS]\n";
+    std::cout << "Show live counters of every running frame and position server.\n\n";
+    std::cout << "CLIENTS is the number of lossless + latest-only clients. WAIT % is\n";
+    std::cout << "the share of time the server spent waiting for lossless clients.\n";
+    std::cout << "Client lag is the number of publications a client has not read.\n\n";
+    std::cout << options << "\n";
+}
+
+int main(int argc, char *argv[]) {
+
+    signal(SIGINT, term);
+    
+    double interval = 1.0;
+    bool once = false;
+    
+    try {
+
+        po::options_description options("OPTIONS");
+        options.add_options()
+                ("help", "Produce help message.")
+                ("version,v", "Print version information.")
+                ("interval,i", po::value<double>(&interval), "Seconds between updates. Defaults to 1.")
+                ("once", "Print the counters once, without rates, and exit.")
+                ;
+
+        po::variables_map variable_map;
+        po::store(po::parse_command_line(argc, argv, options), variable_map);
+        po::notify(variable_map);
+
+        if (variable_map.count("help")) {
+            printUsage(options);
+            return 0;
+        }
+
+        if (variable_map.count("version")) {
+            std::cout << "Simple-Tracker Stats Monitor, version 1.0\n"; //TODO: Cmake managed versioning
+            std::cout << "Written by Jonathan P. Newman in the MWL@MIT.\n";
+            std::cout << "Licensed under the GPL3.0.\n";
+            return 0;
+        }
+        
+        once = variable_map.count("once") > 0;
+        
+        if (!(interval > 0)) {
+            std::cerr << "Error: INTERVAL must be positive." << std::endl;
+            return 1;
+        }
+
+    } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    StatsMonitor monitor;
+    
+    if (once) {
+        monitor.print(std::cout);
+        return 0;
+    }
+
+    while (!done) {
+        
+        // Clear the terminal and print from the top, like top
+        std::cout << "\033[2J\033[H";
+        monitor.print(std::cout);
+        std::cout << std::flush;
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(interval * 1000)));
+    }
+
+    return 0;
+}
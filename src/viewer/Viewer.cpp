@@ -29,8 +29,9 @@ Viewer::Viewer(std::string source_name) :
 frame_source(source_name)
 , name(source_name + "_viewer") {
 
-    // Find the shard cv::Mat
-    int client_num = frame_source.findSharedMat();
+    // Find the shard cv::Mat. The viewer should never slow down the 
+    // processing chain, so it only asks for the latest frame.
+    int client_num = frame_source.findSharedMat(shmem::QoS::LATEST_ONLY);
     name = name + std::to_string(client_num);
 
     cv::namedWindow(name);
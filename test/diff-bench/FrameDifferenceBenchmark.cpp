@@ -0,0 +1,91 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "FrameDifferenceBenchmark.h"
+
+#include <chrono>
+#include <opencv2/imgproc.hpp>
+
+// Frame pairs run before timing starts, to settle caches and allocations
+#define DIFFBENCH_WARMUP_FRAMES 10
+
+FrameDifferenceBenchmark::FrameDifferenceBenchmark(const std::vector<cv::Mat>& frames) :
+source_frames(frames.size()) {
+    
+    for (size_t i = 0; i < frames.size(); ++i) {
+        cv::cvtColor(frames[i], source_frames[i], cv::COLOR_BGR2GRAY);
+    }
+}
+
+void FrameDifferenceBenchmark::printHeader(std::ostream& out) {
+    
+    out << "width,height,threshold,box_size,frames,"
+        << "difference_ns,opencv_threshold_ns,mismatches" << std::endl;
+}
+
+void FrameDifferenceBenchmark::run(const cv::Size& resolution, int threshold, int box_size, std::ostream& out) {
+    
+    difference.set_threshold(threshold);
+    difference.set_box_size(box_size);
+    
+    // Resizing is not part of what is being measured
+    std::vector<cv::Mat> frames(source_frames.size());
+    for (size_t i = 0; i < source_frames.size(); ++i) {
+        cv::resize(source_frames[i], frames[i], resolution);
+    }
+    
+    int64_t difference_ns = 0;
+    int64_t reference_ns = 0;
+    int64_t mismatches = 0;
+    cv::Mat mask(resolution, CV_8UC1), reference_mask, unequal;
+    int number_of_pairs = static_cast<int>(frames.size()) - 1;
+    
+    for (int i = -DIFFBENCH_WARMUP_FRAMES; i < number_of_pairs; ++i) {
+        
+        int pair = ((i % number_of_pairs) + number_of_pairs) % number_of_pairs;
+        const cv::Mat& previous = frames[pair];
+        const cv::Mat& current = frames[pair + 1];
+        
+        // As DifferenceDetector did before FrameDifference
+        auto reference_start = std::chrono::steady_clock::now();
+        cv::absdiff(current, previous, reference_mask);
+        cv::threshold(reference_mask, reference_mask, threshold, 255, cv::THRESH_BINARY);
+        if (box_size > 1) {
+            cv::blur(reference_mask, reference_mask, cv::Size(box_size, box_size));
+        }
+        cv::threshold(reference_mask, reference_mask, threshold, 255, cv::THRESH_BINARY);
+        auto reference_end = std::chrono::steady_clock::now();
+        
+        auto difference_start = std::chrono::steady_clock::now();
+        difference.apply(current, previous, mask);
+        auto difference_end = std::chrono::steady_clock::now();
+        
+        if (i < 0) {
+            continue;
+        }
+        
+        cv::compare(reference_mask, mask, unequal, cv::CMP_NE);
+        mismatches += cv::countNonZero(unequal);
+        
+        reference_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(reference_end - reference_start).count();
+        difference_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(difference_end - difference_start).count();
+    }
+    
+    out << resolution.width << ',' << resolution.height << ',' 
+        << threshold << ',' << box_size << ',' << number_of_pairs << ','
+        << difference_ns / number_of_pairs << ',' 
+        << reference_ns / number_of_pairs << ',' << mismatches << std::endl;
+}
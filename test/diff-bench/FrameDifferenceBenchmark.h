@@ -0,0 +1,54 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef FRAMEDIFFERENCEBENCHMARK_H
+#define	FRAMEDIFFERENCEBENCHMARK_H
+
+#include <iostream>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+
+#include "../../src/detector/FrameDifference.h"
+
+/**
+ * Times FrameDifference against the OpenCV passes it replaced, cv::absdiff,
+ * cv::threshold, cv::blur and cv::threshold, on consecutive frames held in 
+ * memory, and counts the pixels where the two masks differ.
+ */
+class FrameDifferenceBenchmark {
+public:
+    
+    FrameDifferenceBenchmark(const std::vector<cv::Mat>& source_frames);
+    
+    // Print the CSV header matching the rows written by run
+    static void printHeader(std::ostream& out);
+    
+    /**
+     * Difference every pair of consecutive frames at the given resolution, 
+     * grey level threshold and box size and write one CSV row of mean 
+     * ns/frame for each implementation. mismatches should be 0.
+     */
+    void run(const cv::Size& resolution, int threshold, int box_size, std::ostream& out);
+    
+private:
+    
+    FrameDifference difference;
+    
+    // Grey, as the detector differences them
+    std::vector<cv::Mat> source_frames;
+};
+
+#endif	/* FRAMEDIFFERENCEBENCHMARK_H */
@@ -0,0 +1,71 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+// Timing and exactness of the difference detector's FrameDifference kernel 
+// against the OpenCV passes it replaced, on recorded video. Prints one CSV 
+// row per resolution and box size.
+//
+// Usage: diffbench [VIDEO-FILE] [MAX-FRAMES] [THRESHOLD]
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "FrameDifferenceBenchmark.h"
+
+int main(int argc, char *argv[]) {
+
+    std::string video_file = argc > 1 ? argv[1] : "../mat-serve-test/drop.avi";
+    size_t max_frames = argc > 2 ? std::atoi(argv[2]) : 200;
+    
+    // The diff_threshold of the example configuration
+    int threshold = argc > 3 ? std::atoi(argv[3]) : 20;
+    
+    // Decode everything up front so that only the differencing is timed
+    cv::VideoCapture video(video_file);
+    if (!video.isOpened()) {
+        std::cerr << "Could not open " + video_file + "\n";
+        return 1;
+    }
+    
+    std::vector<cv::Mat> frames;
+    cv::Mat frame;
+    while (frames.size() < max_frames && video.read(frame)) {
+        frames.push_back(frame.clone());
+    }
+    
+    if (frames.size() < 2) {
+        std::cerr << "Fewer than two frames in " + video_file + "\n";
+        return 1;
+    }
+
+    FrameDifferenceBenchmark benchmark(frames);
+    
+    const cv::Size resolutions[] = {cv::Size(320, 240), cv::Size(640, 480), cv::Size(1280, 960)};
+    const int box_sizes[] = {1, 2, 5, 11};
+    
+    FrameDifferenceBenchmark::printHeader(std::cout);
+    
+    for (int r = 0; r < 3; ++r) {
+        for (int b = 0; b < 4; ++b) {
+            benchmark.run(resolutions[r], threshold, box_sizes[b], std::cout);
+        }
+    }
+
+    return 0;
+}
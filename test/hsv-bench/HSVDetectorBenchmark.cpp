@@ -0,0 +1,139 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "HSVDetectorBenchmark.h"
+
+#include <chrono>
+#include <unistd.h>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <opencv2/imgproc.hpp>
+
+// Frames run before timing starts, to settle caches and allocations
+#define HSVBENCH_WARMUP_FRAMES 10
+
+// Stages timed for each frame, in order
+enum BenchmarkStage {
+    THRESHOLD = 0,
+    CLARIFY,
+    SIFT,
+    TUNE,
+    NUMBER_OF_STAGES
+};
+
+// Default thresholds are those of the blue LED in the example configuration
+HSVDetectorBenchmark::HSVDetectorBenchmark(const std::vector<cv::Mat>& frames) :
+  source_name("hsvbench_" + std::to_string(getpid()))
+, detector(source_name, source_name + "_pos", 106, 126, 237, 256, 150, 256)
+, source_frames(frames) { }
+
+HSVDetectorBenchmark::~HSVDetectorBenchmark() {
+    
+    boost::interprocess::shared_memory_object::remove((source_name + "_sh_mem").c_str());
+}
+
+void HSVDetectorBenchmark::configure(std::string file_name, std::string key) {
+    
+    detector.configure(file_name, key);
+    
+    // Tuning windows would dominate the timings
+    detector.set_tune_mode(false);
+}
+
+void HSVDetectorBenchmark::printHeader(std::ostream& out) {
+    
+    out << "width,height,erode,dilate,frames,kernel,lut_bits,threads,"
+        << "threshold_ns,clarify_ns,sift_ns,tune_ns,total_ns,found,"
+        << "opencv_threshold_ns,mismatches" << std::endl;
+}
+
+void HSVDetectorBenchmark::run(const cv::Size& resolution, int erode_px, int dilate_px, std::ostream& out) {
+    
+    detector.set_erode_size(erode_px);
+    detector.set_dilate_size(dilate_px);
+    
+    // Resizing is not part of what is being measured
+    std::vector<cv::Mat> frames(source_frames.size());
+    for (size_t i = 0; i < source_frames.size(); ++i) {
+        cv::resize(source_frames[i], frames[i], resolution);
+    }
+    
+    int64_t stage_ns[NUMBER_OF_STAGES] = {0};
+    int found = 0;
+    
+    // The cvtColor and inRange passes that the fused threshold replaced, 
+    // timed and compared on the same frames
+    int64_t reference_ns = 0;
+    int64_t mismatches = 0;
+    cv::Mat reference_mask, difference;
+    int number_of_frames = static_cast<int>(frames.size());
+    
+    for (int i = -HSVBENCH_WARMUP_FRAMES; i < number_of_frames; ++i) {
+        
+        // The detector reads its input from a read-only view, as it would 
+        // from shared memory
+        const cv::Mat& frame = frames[((i % number_of_frames) + number_of_frames) % number_of_frames];
+        detector.set_frame(frame);
+        
+        // The reference runs first and is compared before anything else
+        // writes to the threshold image
+        auto reference_start = std::chrono::steady_clock::now();
+        detector.get_hsv_threshold().applyReference(frame, reference_mask);
+        auto reference_end = std::chrono::steady_clock::now();
+        
+        std::chrono::steady_clock::time_point begin[NUMBER_OF_STAGES], end[NUMBER_OF_STAGES];
+        begin[THRESHOLD] = std::chrono::steady_clock::now();
+        detector.applyThreshold();
+        end[THRESHOLD] = std::chrono::steady_clock::now();
+        
+        cv::compare(reference_mask, detector.get_threshold_image(), difference, cv::CMP_NE);
+        
+        begin[CLARIFY] = std::chrono::steady_clock::now();
+        detector.clarifyBlobs();
+        end[CLARIFY] = begin[SIFT] = std::chrono::steady_clock::now();
+        detector.siftBlobs();
+        end[SIFT] = begin[TUNE] = std::chrono::steady_clock::now();
+        detector.tune();
+        end[TUNE] = std::chrono::steady_clock::now();
+        
+        if (i < 0) {
+            continue;
+        }
+        
+        for (int s = 0; s < NUMBER_OF_STAGES; ++s) {
+            stage_ns[s] += std::chrono::duration_cast<std::chrono::nanoseconds>(end[s] - begin[s]).count();
+        }
+        
+        reference_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(reference_end - reference_start).count();
+        mismatches += cv::countNonZero(difference);
+        
+        found += detector.get_object_position().position_valid;
+    }
+    
+    out << resolution.width << ',' << resolution.height << ',' 
+        << erode_px << ',' << dilate_px << ',' << number_of_frames << ','
+        << HSVThreshold::kernelName(HSVThreshold::bestKernel()) << ','
+        << detector.get_lut_bits() << ','
+        << detector.get_threads();
+    
+    int64_t total_ns = 0;
+    for (int s = 0; s < NUMBER_OF_STAGES; ++s) {
+        out << ',' << stage_ns[s] / number_of_frames;
+        total_ns += stage_ns[s];
+    }
+    
+    out << ',' << total_ns / number_of_frames << ',' << found << ','
+        << reference_ns / number_of_frames << ',' << mismatches << std::endl;
+}
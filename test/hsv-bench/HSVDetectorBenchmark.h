@@ -0,0 +1,63 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef HSVDETECTORBENCHMARK_H
+#define	HSVDETECTORBENCHMARK_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+
+#include "../../src/detector/HSVDetector.h"
+
+/**
+ * Times each stage of HSVDetector on frames held in memory. Frames are fed 
+ * straight into the detector, so neither decoding nor shared memory 
+ * contribute to the timings.
+ */
+class HSVDetectorBenchmark {
+public:
+    
+    HSVDetectorBenchmark(const std::vector<cv::Mat>& source_frames);
+    ~HSVDetectorBenchmark();
+    
+    // Use the thresholds and kernel sizes of a detector configuration
+    void configure(std::string file_name, std::string key);
+    
+    // Print the CSV header matching the rows written by run
+    static void printHeader(std::ostream& out);
+    
+    /**
+     * Run every frame through the detector at the given resolution and 
+     * erode/dilate sizes and write one CSV row of mean ns/frame per stage.
+     * The row also times the OpenCV passes the fused threshold replaced and
+     * counts the pixels where the two masks differ. That should be none,
+     * unless the configuration sets lut_bits below 8.
+     */
+    void run(const cv::Size& resolution, int erode_px, int dilate_px, std::ostream& out);
+    
+private:
+    
+    // Detectors attach to an image source on construction. This one is 
+    // never served and is removed again on destruction.
+    const std::string source_name;
+    HSVDetector detector;
+    
+    std::vector<cv::Mat> source_frames;
+};
+
+#endif	/* HSVDETECTORBENCHMARK_H */
@@ -0,0 +1,71 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+// Per-stage timing of the HSV detector on recorded video. Prints one CSV row
+// per resolution and erode/dilate size with the mean ns/frame of each stage.
+//
+// Usage: hsvbench [VIDEO-FILE] [MAX-FRAMES] [CONFIG-FILE CONFIG-KEY]
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "HSVDetectorBenchmark.h"
+
+int main(int argc, char *argv[]) {
+
+    std::string video_file = argc > 1 ? argv[1] : "../mat-serve-test/drop.avi";
+    size_t max_frames = argc > 2 ? std::atoi(argv[2]) : 200;
+    
+    // Decode everything up front so that only the detector is timed
+    cv::VideoCapture video(video_file);
+    if (!video.isOpened()) {
+        std::cerr << "Could not open " + video_file + "\n";
+        return 1;
+    }
+    
+    std::vector<cv::Mat> frames;
+    cv::Mat frame;
+    while (frames.size() < max_frames && video.read(frame)) {
+        frames.push_back(frame.clone());
+    }
+    
+    if (frames.empty()) {
+        std::cerr << "No frames in " + video_file + "\n";
+        return 1;
+    }
+
+    HSVDetectorBenchmark benchmark(frames);
+    
+    if (argc > 4) {
+        benchmark.configure(argv[3], argv[4]);
+    }
+    
+    const cv::Size resolutions[] = {cv::Size(320, 240), cv::Size(640, 480), cv::Size(1280, 960)};
+    const int kernel_sizes[] = {0, 3, 7, 15};
+    
+    HSVDetectorBenchmark::printHeader(std::cout);
+    
+    for (int r = 0; r < 3; ++r) {
+        for (int k = 0; k < 4; ++k) {
+            benchmark.run(resolutions[r], kernel_sizes[k], kernel_sizes[k], std::cout);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include "KalmanFilterBenchmark.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <unistd.h>
+#include <boost/interprocess/shared_memory_object.hpp>
+
+// Mean length, in samples, of a run of dropouts
+#define KFBENCH_MEAN_DROPOUT_LENGTH 10
+
+// Fixed so that every run sees the same noise and dropouts
+#define KFBENCH_SEED 1
+
+KalmanFilterBenchmark::KalmanFilterBenchmark(size_t number_of_samples, float measurement_sigma) :
+  base_name("kfbench_" + std::to_string(getpid()))
+, filter(base_name + "_raw", base_name + "_filt")
+, simulator(base_name + "_truth") {
+    
+    std::default_random_engine generator(KFBENCH_SEED);
+    std::normal_distribution<float> noise(0.0, measurement_sigma);
+    
+    truth.reserve(number_of_samples);
+    measurements.reserve(number_of_samples);
+    
+    for (size_t i = 0; i < number_of_samples; ++i) {
+        
+        shmem::Position position = simulator.simulatePosition();
+        truth.push_back(position);
+        
+        // Detectors measure position only
+        position.position.x += noise(generator);
+        position.position.y += noise(generator);
+        position.position.z += noise(generator);
+        position.velocity_valid = false;
+        measurements.push_back(position);
+    }
+}
+
+KalmanFilterBenchmark::~KalmanFilterBenchmark() {
+    
+    boost::interprocess::shared_memory_object::remove((base_name + "_raw_sh_mem").c_str());
+}
+
+void KalmanFilterBenchmark::printHeader(std::ostream& out) {
+    
+    out << "sig_accel,sig_noise,dropout,not_found_threshold,samples,valid,"
+        << "measurement_rmse,position_rmse,velocity_rmse,positions_per_s" << std::endl;
+}
+
+void KalmanFilterBenchmark::run(float sig_accel, float sig_measure_noise, double dropout_rate,
+                                int not_found_count_threshold, std::ostream& out) {
+    
+    // Start from scratch, as after a long dropout
+    filter.reset(DT, sig_accel, sig_measure_noise, not_found_count_threshold);
+    filter.set_tune_mode(false);
+    
+    std::vector<bool> dropped = dropouts(dropout_rate);
+    
+    int64_t filter_ns = 0;
+    size_t valid = 0, measured = 0;
+    double measurement_se = 0, position_se = 0, velocity_se = 0;
+    
+    for (size_t i = 0; i < measurements.size(); ++i) {
+        
+        shmem::Position measurement = measurements[i];
+        measurement.position_valid = !dropped[i];
+        
+        auto start = std::chrono::steady_clock::now();
+        const shmem::Position& filtered = filter.filterMeasurement(measurement);
+        filter_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        
+        if (!dropped[i]) {
+            cv::Point3f error = measurements[i].position - truth[i].position;
+            measurement_se += error.x * error.x + error.y * error.y + error.z * error.z;
+            measured++;
+        }
+        
+        if (filtered.position_valid) {
+            cv::Point3f error = filtered.position - truth[i].position;
+            position_se += error.x * error.x + error.y * error.y + error.z * error.z;
+            error = filtered.velocity - truth[i].velocity;
+            velocity_se += error.x * error.x + error.y * error.y + error.z * error.z;
+            valid++;
+        }
+    }
+    
+    out << sig_accel << ',' << sig_measure_noise << ',' << dropout_rate << ','
+        << not_found_count_threshold << ',' << measurements.size() << ',' << valid << ','
+        << (measured > 0 ? std::sqrt(measurement_se / measured) : 0) << ','
+        << (valid > 0 ? std::sqrt(position_se / valid) : 0) << ','
+        << (valid > 0 ? std::sqrt(velocity_se / valid) : 0) << ','
+        << (filter_ns > 0 ? static_cast<int64_t>(measurements.size() * 1.0e9 / filter_ns) : 0) 
+        << std::endl;
+}
+
+std::vector<bool> KalmanFilterBenchmark::dropouts(double dropout_rate) {
+    
+    std::vector<bool> dropped(measurements.size(), false);
+    
+    if (dropout_rate <= 0) {
+        return dropped;
+    }
+    
+    // Two state Markov chain. Runs end with probability 1/length, and start
+    // often enough that dropout_rate of all samples are dropped.
+    double p_end = 1.0 / KFBENCH_MEAN_DROPOUT_LENGTH;
+    double p_start = dropout_rate >= 1 ? 1 : p_end * dropout_rate / (1 - dropout_rate);
+    
+    std::default_random_engine generator(KFBENCH_SEED);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    
+    bool in_dropout = false;
+    for (size_t i = 0; i < dropped.size(); ++i) {
+        in_dropout = uniform(generator) < (in_dropout ? 1 - p_end : p_start);
+        dropped[i] = in_dropout;
+    }
+    
+    return dropped;
+}
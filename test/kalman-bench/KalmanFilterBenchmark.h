@@ -0,0 +1,75 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#ifndef KALMANFILTERBENCHMARK_H
+#define	KALMANFILTERBENCHMARK_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../../lib/shmem/Position.h"
+#include "../../src/posifilt/KalmanFilter.h"
+#include "../testpos/TestPosition.h"
+
+/**
+ * Measures the accuracy and throughput of KalmanFilter against the known 
+ * motion of TestPosition. The trajectory is simulated once, noise is added to
+ * make measurements, and every run filters the same measurements, so runs 
+ * differ only in filter parameters and dropouts. Positions are fed straight
+ * into the filter, so shared memory does not contribute to the timings.
+ */
+class KalmanFilterBenchmark {
+public:
+    
+    /**
+     * @param number_of_samples Length of the simulated trajectory.
+     * @param measurement_sigma Standard deviation of the noise added to each 
+     * coordinate of the true position.
+     */
+    KalmanFilterBenchmark(size_t number_of_samples, float measurement_sigma);
+    ~KalmanFilterBenchmark();
+    
+    // Print the CSV header matching the rows written by run
+    static void printHeader(std::ostream& out);
+    
+    /**
+     * Filter the measurements once and write one CSV row.
+     * @param sig_accel Filter's assumed standard deviation of acceleration.
+     * @param sig_measure_noise Filter's assumed measurement noise.
+     * @param dropout_rate Fraction of measurements that are invalid. Dropouts
+     * come in bursts, as when the animal is occluded.
+     * @param not_found_count_threshold Consecutive dropouts after which the 
+     * filter stops reporting a position.
+     */
+    void run(float sig_accel, float sig_measure_noise, double dropout_rate, 
+             int not_found_count_threshold, std::ostream& out);
+    
+private:
+    
+    // Filters and simulators attach to shared memory on construction. These
+    // are never served and are removed again on destruction.
+    const std::string base_name;
+    KalmanFilter filter;
+    TestPosition simulator;
+    
+    std::vector<shmem::Position> truth;
+    std::vector<shmem::Position> measurements;
+    
+    std::vector<bool> dropouts(double dropout_rate);
+};
+
+#endif	/* KALMANFILTERBENCHMARK_H */
@@ -0,0 +1,57 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+// Accuracy and throughput of the Kalman filter on simulated motion. Prints one
+// CSV row per combination of filter parameters and dropout rate.
+//
+// Usage: kfbench [SAMPLES] [MEASUREMENT-SIGMA]
+
+#include <cstdlib>
+#include <iostream>
+
+#include "KalmanFilterBenchmark.h"
+
+int main(int argc, char *argv[]) {
+
+    int number_of_samples = argc > 1 ? std::atoi(argv[1]) : 20000;
+    float measurement_sigma = argc > 2 ? std::atof(argv[2]) : 2.0;
+    
+    if (number_of_samples <= 0 || !(measurement_sigma > 0)) {
+        std::cerr << "SAMPLES and MEASUREMENT-SIGMA must be positive.\n";
+        exit(EXIT_FAILURE);
+    }
+    
+    KalmanFilterBenchmark benchmark(number_of_samples, measurement_sigma);
+    
+    const float sig_accels[] = {1, 5, 20};
+    const float sig_noises[] = {0.5, 2, 8};
+    const double dropout_rates[] = {0, 0.1, 0.3};
+    const int thresholds[] = {5, 25, 100};
+    
+    KalmanFilterBenchmark::printHeader(std::cout);
+    
+    for (float sig_accel : sig_accels) {
+        for (float sig_noise : sig_noises) {
+            for (double dropout_rate : dropout_rates) {
+                for (int threshold : thresholds) {
+                    benchmark.run(sig_accel, sig_noise, dropout_rate, threshold, std::cout);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
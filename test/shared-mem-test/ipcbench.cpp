@@ -0,0 +1,350 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+// Throughput, latency and CPU cost of the shared memory transport. Sweeps 
+// payload type, frame size, number of clients and buffer depth. Each client 
+// is a separate process, as in a real pipeline. Servers block when full. Mat 
+// and position clients are lossless, so every frame reaches every client and
+// the producer runs as fast as the slowest client allows. Seqlock clients 
+// read positions through SeqLockSharedMemoryObject, which never makes the 
+// server wait, so they may skip positions and receive fewer than were pushed.
+//
+// One CSV row is printed per run:
+//   payload       mat, position or seqlock
+//   width, height, channels  Frame geometry, zero for positions
+//   clients       Number of client processes
+//   depth         Frame slots for MatServer, buffer depth for SMServer
+//   frames        Frames pushed
+//   received      Fewest frames received by any client
+//   frames_per_s  Frames pushed per second until the last client finished
+//   p50_us, p99_us, max_us  Push-to-read latency of the slowest client
+//   producer_cpu_us  CPU time of the producer process per frame, including
+//                    its server thread
+//   client_cpu_us    Mean CPU time of a client process per frame
+//
+// With the default push period of zero the producer is unpaced and latency 
+// includes queueing. Give a period to measure latency at a realistic rate.
+//
+// Usage: ipcbench [frames_per_run] [push_period_in_us]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <opencv2/core/core.hpp>
+
+#include "../../lib/shmem/LatencyHistogram.h"
+#include "../../lib/shmem/MatServer.h"
+#include "../../lib/shmem/MatClient.h"
+#include "../../lib/shmem/Position.h"
+#include "../../lib/shmem/SeqLockSharedMemoryObject.h"
+#include "../../lib/shmem/SMServer.h"
+#include "../../lib/shmem/SMClient.h"
+#include "../../lib/shmem/SyncSharedMemoryObject.h"
+
+// A client gives up once nothing has arrived for this many read timeouts
+#define IPCBENCH_IDLE_READS 20
+
+enum class Payload { MAT, POSITION, SEQLOCK };
+
+struct RunConfig {
+    Payload payload;
+    int width, height, channels;
+    int clients;
+    int depth;
+    int frames;
+    int period_us;
+};
+
+// Sent by each client process to the producer when it is done
+struct ClientResult {
+    int64_t received;
+    int64_t p50_ns, p99_ns, max_ns;
+};
+
+static int64_t cpuTimeInNs(const struct rusage& usage) {
+    
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000LL +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+}
+
+static ClientResult summarize(const shmem::LatencyHistogram& latency) {
+    
+    ClientResult result;
+    result.received = latency.get_count();
+    result.p50_ns = latency.valueAtPercentile(50.0);
+    result.p99_ns = latency.valueAtPercentile(99.0);
+    result.max_ns = latency.get_max();
+    
+    return result;
+}
+
+static ClientResult runMatClient(const std::string& name, int frames, int ready_fd) {
+    
+    MatClient client(name);
+    client.findSharedMat();
+    
+    char ready = 1;
+    if (write(ready_fd, &ready, 1) != 1) {
+        exit(EXIT_FAILURE);
+    }
+    
+    shmem::LatencyHistogram latency;
+    cv::Mat frame;
+    int idle_reads = 0;
+    
+    while (latency.get_count() < static_cast<uint64_t>(frames) && idle_reads < IPCBENCH_IDLE_READS) {
+        
+        if (client.getSharedMat(frame)) {
+            latency.record(shmem::Sample::nowInNs() - client.get_sample().capture_time_ns);
+            idle_reads = 0;
+        } else {
+            idle_reads++;
+        }
+    }
+    
+    return summarize(latency);
+}
+
+// Reads until the last position pushed has arrived, which for lossless 
+// clients is also the number of positions pushed
+template<template <typename> class SharedMemType>
+static ClientResult runPositionClient(const std::string& name, int frames, int ready_fd) {
+    
+    shmem::SMClient<shmem::Position, SharedMemType> client(name);
+    client.findSharedObject();
+    
+    char ready = 1;
+    if (write(ready_fd, &ready, 1) != 1) {
+        exit(EXIT_FAILURE);
+    }
+    
+    shmem::LatencyHistogram latency;
+    shmem::Position position;
+    int idle_reads = 0;
+    
+    while (position.sample.number < static_cast<uint64_t>(frames) && idle_reads < IPCBENCH_IDLE_READS) {
+        
+        if (client.getSharedObject(position)) {
+            latency.record(shmem::Sample::nowInNs() - position.sample.capture_time_ns);
+            idle_reads = 0;
+        } else {
+            idle_reads++;
+        }
+    }
+    
+    return summarize(latency);
+}
+
+// Wait for the clients to read the last frame and exit. This has to happen 
+// before the server is torn down. 
+// @return Total CPU time used by the clients
+static int64_t reapClients(const std::vector<pid_t>& pids) {
+    
+    int64_t cpu_ns = 0;
+    
+    for (size_t i = 0; i < pids.size(); ++i) {
+        
+        int status;
+        struct rusage usage;
+        wait4(pids[i], &status, 0, &usage);
+        cpu_ns += cpuTimeInNs(usage);
+    }
+    
+    return cpu_ns;
+}
+
+static int64_t produceMats(const std::string& name, const RunConfig& config, const std::vector<pid_t>& pids) {
+    
+    MatServer server(name, config.depth, shmem::OverflowPolicy::BLOCK);
+    
+    cv::Mat frame(config.height, config.width, CV_MAKETYPE(CV_8U, config.channels), cv::Scalar::all(0));
+    shmem::Sample sample;
+    
+    for (int i = 0; i < config.frames; ++i) {
+        sample.stampNext();
+        server.pushMat(frame, sample);
+        if (config.period_us > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(config.period_us));
+        }
+    }
+    
+    return reapClients(pids);
+}
+
+template<template <typename> class SharedMemType>
+static int64_t producePositions(const std::string& name, const RunConfig& config, const std::vector<pid_t>& pids) {
+    
+    shmem::SMServer<shmem::Position, SharedMemType> server(name, shmem::OverflowPolicy::BLOCK, config.depth);
+    
+    shmem::Position position;
+    
+    for (int i = 0; i < config.frames; ++i) {
+        position.sample.stampNext();
+        server.pushObject(position);
+        if (config.period_us > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(config.period_us));
+        }
+    }
+    
+    return reapClients(pids);
+}
+
+static void run(const RunConfig& config, int run_number) {
+    
+    std::string name = "ipcbench_" + std::to_string(getpid()) + "_" + std::to_string(run_number);
+    
+    int ready_pipe[2], result_pipe[2];
+    if (pipe(ready_pipe) != 0 || pipe(result_pipe) != 0) {
+        std::cerr << "Could not create pipes.\n";
+        exit(EXIT_FAILURE);
+    }
+    
+    // Clients are forked before the server starts its thread
+    std::vector<pid_t> pids;
+    for (int i = 0; i < config.clients; ++i) {
+        
+        pid_t pid = fork();
+        
+        if (pid == 0) {
+            
+            ClientResult result = {0, 0, 0, 0};
+            switch (config.payload) {
+                case Payload::MAT:
+                    result = runMatClient(name, config.frames, ready_pipe[1]);
+                    break;
+                case Payload::POSITION:
+                    result = runPositionClient<shmem::SyncSharedMemoryObject>(name, config.frames, ready_pipe[1]);
+                    break;
+                case Payload::SEQLOCK:
+                    result = runPositionClient<shmem::SeqLockSharedMemoryObject>(name, config.frames, ready_pipe[1]);
+                    break;
+            }
+            
+            if (write(result_pipe[1], &result, sizeof(result)) != sizeof(result)) {
+                _exit(EXIT_FAILURE);
+            }
+            _exit(EXIT_SUCCESS);
+        }
+        
+        pids.push_back(pid);
+    }
+    
+    // Wait for every client to register so that none misses the first frame
+    for (int i = 0; i < config.clients; ++i) {
+        char ready;
+        if (read(ready_pipe[0], &ready, 1) != 1) {
+            std::cerr << "A client failed to start.\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    struct rusage producer_start, producer_end;
+    getrusage(RUSAGE_SELF, &producer_start);
+    auto start = std::chrono::steady_clock::now();
+    
+    int64_t client_cpu_ns = 0;
+    switch (config.payload) {
+        case Payload::MAT:
+            client_cpu_ns = produceMats(name, config, pids);
+            break;
+        case Payload::POSITION:
+            client_cpu_ns = producePositions<shmem::SyncSharedMemoryObject>(name, config, pids);
+            break;
+        case Payload::SEQLOCK:
+            client_cpu_ns = producePositions<shmem::SeqLockSharedMemoryObject>(name, config, pids);
+            break;
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    getrusage(RUSAGE_SELF, &producer_end);
+    
+    ClientResult worst = {config.frames, 0, 0, 0};
+    for (int i = 0; i < config.clients; ++i) {
+        
+        ClientResult result;
+        if (read(result_pipe[0], &result, sizeof(result)) != sizeof(result)) {
+            std::cerr << "A client did not report its results.\n";
+            exit(EXIT_FAILURE);
+        }
+        
+        worst.received = std::min(worst.received, result.received);
+        worst.p50_ns = std::max(worst.p50_ns, result.p50_ns);
+        worst.p99_ns = std::max(worst.p99_ns, result.p99_ns);
+        worst.max_ns = std::max(worst.max_ns, result.max_ns);
+    }
+    
+    close(ready_pipe[0]);
+    close(ready_pipe[1]);
+    close(result_pipe[0]);
+    close(result_pipe[1]);
+    
+    double producer_cpu_us = (cpuTimeInNs(producer_end) - cpuTimeInNs(producer_start)) / 1000.0 / config.frames;
+    double client_cpu_us = client_cpu_ns / 1000.0 / config.clients / config.frames;
+    
+    const char* payload_names[] = {"mat", "position", "seqlock"};
+    
+    std::cout << payload_names[static_cast<int>(config.payload)] << ','
+            << config.width << ',' << config.height << ',' << config.channels << ','
+            << config.clients << ',' << config.depth << ','
+            << config.frames << ',' << worst.received << ','
+            << config.frames / seconds << ','
+            << worst.p50_ns / 1000.0 << ',' << worst.p99_ns / 1000.0 << ',' << worst.max_ns / 1000.0 << ','
+            << producer_cpu_us << ',' << client_cpu_us << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+
+    int frames = argc > 1 ? std::atoi(argv[1]) : 500;
+    int period_us = argc > 2 ? std::atoi(argv[2]) : 0;
+    
+    const int client_counts[] = {1, 2, 4};
+    const int slot_counts[] = {2, 4, 8};
+    const int buffer_depths[] = {1, 10, 100};
+    const cv::Size frame_sizes[] = {cv::Size(320, 240), cv::Size(640, 480), cv::Size(1280, 960)};
+    
+    std::cout << "payload,width,height,channels,clients,depth,frames,received,frames_per_s,"
+              << "p50_us,p99_us,max_us,producer_cpu_us,client_cpu_us" << std::endl;
+    
+    int run_number = 0;
+    
+    for (int c = 0; c < 3; ++c) {
+        for (int d = 0; d < 3; ++d) {
+            
+            RunConfig config = {Payload::POSITION, 0, 0, 0, client_counts[c], buffer_depths[d], frames, period_us};
+            run(config, run_number++);
+            
+            RunConfig seqlock_config = {Payload::SEQLOCK, 0, 0, 0, client_counts[c], buffer_depths[d], frames, period_us};
+            run(seqlock_config, run_number++);
+            
+            for (int s = 0; s < 3; ++s) {
+                
+                RunConfig mat_config = {Payload::MAT, frame_sizes[s].width, frame_sizes[s].height, 3, 
+                                        client_counts[c], slot_counts[d], frames, period_us};
+                run(mat_config, run_number++);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+//******************************************************************************
+//* Copyright (c) Jon Newman (jpnewman at mit snail edu) 
+//* All right reserved.
+//* This file is part of the Simple Tracker project.
+//* This is free software: you can redistribute it and/or modify
+//* it under the terms of the GNU General Public License as published by
+//* the Free Software Foundation, either version 3 of the License, or
+//* (at your option) any later version.
+//* This software is distributed in the hope that it will be useful,
+//* but WITHOUT ANY WARRANTY; without even the implied warranty of
+//* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//* GNU General Public License for more details.
+//* You should have received a copy of the GNU General Public License
+//* along with this source code.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+// Measures the time from pushObject/pushMat until a client in another thread
+// has the sample, which is dominated by how quickly the server thread wakes up
+// to publish. Samples are pushed at a fixed period so that each push finds the
+// server thread idle.
+//
+// Usage: publatency [number_of_samples] [push_period_in_us]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+#include "../../lib/shmem/SMServer.h"
+#include "../../lib/shmem/SMClient.h"
+#include "../../lib/shmem/MatServer.h"
+#include "../../lib/shmem/MatClient.h"
+#include "../../lib/shmem/Position.h"
+#include "../../lib/shmem/SeqLockSharedMemoryObject.h"
+#include "../../lib/shmem/SyncSharedMemoryObject.h"
+
+void printPercentiles(const std::string& title, std::vector<int64_t> latencies_ns) {
+
+    if (latencies_ns.empty()) {
+        std::cout << title << ": no samples received\n";
+        return;
+    }
+
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    size_t n = latencies_ns.size();
+
+    std::cout << title << " (" << n << " samples)"
+            << "  p50: " << latencies_ns[n / 2] / 1000.0 << " us"
+            << "  p99: " << latencies_ns[std::min(n - 1, n * 99 / 100)] / 1000.0 << " us"
+            << "  max: " << latencies_ns[n - 1] / 1000.0 << " us\n";
+}
+
+template<template <typename> class SharedMemType>
+std::vector<int64_t> benchmarkPosition(const std::string& name, int number_of_samples, int period_us) {
+
+    shmem::SMServer<shmem::Position, SharedMemType> server(name);
+    shmem::SMClient<shmem::Position, SharedMemType> client(name);
+    client.findSharedObject();
+
+    std::vector<int64_t> latencies_ns;
+    std::atomic<bool> done(false);
+
+    std::thread reader([&] {
+        shmem::Position position;
+        while (!done && latencies_ns.size() < static_cast<size_t>(number_of_samples)) {
+            if (client.getSharedObject(position)) {
+                latencies_ns.push_back(shmem::Sample::nowInNs() - position.sample.capture_time_ns);
+            }
+        }
+    });
+
+    shmem::Position position;
+    for (int i = 0; i < number_of_samples; ++i) {
+        position.sample.stampNext();
+        server.pushObject(position);
+        std::this_thread::sleep_for(std::chrono::microseconds(period_us));
+    }
+
+    done = true;
+    reader.join();
+
+    return latencies_ns;
+}
+
+std::vector<int64_t> benchmarkMat(int number_of_samples, int period_us) {
+
+    MatServer server("publatency_mat");
+    MatClient client("publatency_mat");
+    client.findSharedMat();
+
+    std::vector<int64_t> latencies_ns;
+    std::atomic<bool> done(false);
+
+    std::thread reader([&] {
+        cv::Mat frame;
+        while (!done && latencies_ns.size() < static_cast<size_t>(number_of_samples)) {
+            if (client.getSharedMat(frame)) {
+                latencies_ns.push_back(shmem::Sample::nowInNs() - client.get_sample().capture_time_ns);
+            }
+        }
+    });
+
+    cv::Mat frame(480, 640, CV_8UC3, cv::Scalar(0));
+    shmem::Sample sample;
+    for (int i = 0; i < number_of_samples; ++i) {
+        sample.stampNext();
+        server.pushMat(frame, sample);
+        std::this_thread::sleep_for(std::chrono::microseconds(period_us));
+    }
+
+    done = true;
+    reader.join();
+
+    return latencies_ns;
+}
+
+int main(int argc, char *argv[]) {
+
+    int number_of_samples = argc > 1 ? std::atoi(argv[1]) : 500;
+    int period_us = argc > 2 ? std::atoi(argv[2]) : 20000; // 50 Hz
+
+    std::cout << "Push-to-publish latency, " << number_of_samples
+            << " samples pushed every " << period_us << " us\n";
+
+    printPercentiles("SMServer<Position>", 
+            benchmarkPosition<shmem::SyncSharedMemoryObject>("publatency_pos", number_of_samples, period_us));
+    printPercentiles("SMServer<Position, SeqLock>", 
+            benchmarkPosition<shmem::SeqLockSharedMemoryObject>("publatency_seqlock", number_of_samples, period_us));
+    printPercentiles("MatServer 640x480x3", benchmarkMat(number_of_samples, period_us));
+
+    return 0;
+}
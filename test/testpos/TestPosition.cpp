@@ -48,12 +48,22 @@ TestPosition::TestPosition(std::string position_sink_name) :
 
 void TestPosition::simulateAndServePosition() {
     
+    // Publish simulated position
+    position_sink.pushObject(simulatePosition());
+}
+
+shmem::Position TestPosition::simulatePosition() {
+    
     // Simulate one step of random, but smooth, motion
     simulateMotion(); 
     
     // Transform into shmem::Positions type
     shmem::Position pos;
     
+    // Stamp like a camera so that downstream joins and latency work
+    current_sample.stampNext();
+    pos.sample = current_sample;
+    
     // Simulated position info
     pos.position_valid = true;
     pos.position.x = state.at<float>(0);
@@ -66,9 +76,7 @@ void TestPosition::simulateAndServePosition() {
     pos.velocity.y = state.at<float>(3);
     pos.velocity.z = state.at<float>(5);
     
-    // Publish simulated position
-    position_sink.pushObject(pos);
-    
+    return pos;
 }
 
 
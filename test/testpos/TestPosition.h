@@ -38,6 +38,9 @@ public:
     // Simulate object position motion and publish to shared memory
     void simulateAndServePosition(void);
     
+    // Step the simulation without serving
+    shmem::Position simulatePosition(void);
+    
     void stop(void) { position_sink.set_running(false); }
     
 private:
@@ -56,6 +59,9 @@ private:
     
     shmem::SMServer<shmem::Position> position_sink;
     
+    // Numbers and capture times of the simulated positions
+    shmem::Sample current_sample;
+    
     void createStaticMatracies(void);
     void simulateMotion(void);
     